@@ -0,0 +1,258 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "arena.h"
+
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <stdlib.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Alignment of allocations, enough for any scalar type.
+ */
+#define ARENA_ALIGN 8
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A scratch arena bound to a task.
+ */
+typedef struct
+{
+    TaskHandle_t task;
+    arena_t *arena;
+} scratch_binding_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Get the scratch arena of the calling task, NULL if none.
+ */
+static arena_t *bound_arena();
+
+/**
+ * @brief Get the scratch arena some memory belongs to, NULL if none.
+ */
+static arena_t *owning_arena(const void *ptr);
+
+/**
+ * @brief Allocate from the heap, PSRAM if available.
+ */
+static void *heap_alloc(size_t size);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static scratch_binding_t bindings[ARENA_SCRATCH_TASKS];
+static portMUX_TYPE bindings_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+esp_err_t arena_init(arena_t *arena, size_t capacity)
+{
+    capacity = (capacity + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    *arena = (arena_t){0};
+    arena->base = (uint8_t *)heap_alloc(capacity);
+    if (arena->base == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    arena->capacity = capacity;
+    return ESP_OK;
+}
+
+
+void *arena_alloc(arena_t *arena, size_t size)
+{
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (aligned == 0)
+    {
+        aligned = ARENA_ALIGN;
+    }
+    if (aligned > arena->capacity - arena->used)
+    {
+        return NULL;
+    }
+
+    void *ptr = arena->base + arena->used;
+    arena->last = arena->used;
+    arena->used += aligned;
+    if (arena->used > arena->peak)
+    {
+        arena->peak = arena->used;
+    }
+    return ptr;
+}
+
+
+void arena_free(arena_t *arena, void *ptr)
+{
+    if (ptr == arena->base + arena->last && arena->last < arena->used)
+    {
+        arena->used = arena->last;
+    }
+}
+
+
+bool arena_contains(const arena_t *arena, const void *ptr)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    return arena->base != NULL && p >= arena->base &&
+           p < arena->base + arena->capacity;
+}
+
+
+void arena_reset(arena_t *arena)
+{
+    arena->used = 0;
+    arena->last = 0;
+}
+
+
+void arena_deinit(arena_t *arena)
+{
+    free(arena->base);
+    *arena = (arena_t){0};
+}
+
+
+esp_err_t arena_scratch_bind(arena_t *arena)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    esp_err_t err = ESP_ERR_NO_MEM;
+
+    portENTER_CRITICAL(&bindings_lock);
+    scratch_binding_t *slot = NULL;
+    for (uint32_t i = 0; i < ARENA_SCRATCH_TASKS; i++)
+    {
+        if (bindings[i].task == task)
+        {
+            slot = &bindings[i];
+            break;
+        }
+        if (slot == NULL && bindings[i].task == NULL)
+        {
+            slot = &bindings[i];
+        }
+    }
+    if (slot != NULL)
+    {
+        slot->task = arena != NULL ? task : NULL;
+        slot->arena = arena;
+        err = ESP_OK;
+    }
+    else if (arena == NULL)
+    {
+        err = ESP_OK;
+    }
+    portEXIT_CRITICAL(&bindings_lock);
+    return err;
+}
+
+
+void *arena_scratch_alloc(size_t size)
+{
+    arena_t *arena = bound_arena();
+    if (arena != NULL)
+    {
+        void *ptr = arena_alloc(arena, size);
+        if (ptr != NULL)
+        {
+            return ptr;
+        }
+        arena->fallbacks++;
+    }
+    return heap_alloc(size);
+}
+
+
+void arena_scratch_free(void *ptr)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+    arena_t *arena = owning_arena(ptr);
+    if (arena == NULL)
+    {
+        free(ptr);
+    }
+    else if (arena == bound_arena())
+    {
+        arena_free(arena, ptr);
+    }
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static arena_t *bound_arena()
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    arena_t *arena = NULL;
+
+    portENTER_CRITICAL(&bindings_lock);
+    for (uint32_t i = 0; i < ARENA_SCRATCH_TASKS; i++)
+    {
+        if (bindings[i].task == task)
+        {
+            arena = bindings[i].arena;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&bindings_lock);
+    return arena;
+}
+
+
+static arena_t *owning_arena(const void *ptr)
+{
+    arena_t *arena = NULL;
+
+    portENTER_CRITICAL(&bindings_lock);
+    for (uint32_t i = 0; i < ARENA_SCRATCH_TASKS; i++)
+    {
+        if (bindings[i].arena != NULL &&
+            arena_contains(bindings[i].arena, ptr))
+        {
+            arena = bindings[i].arena;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&bindings_lock);
+    return arena;
+}
+
+
+static void *heap_alloc(size_t size)
+{
+    void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (ptr == NULL)
+    {
+        ptr = malloc(size);
+    }
+    return ptr;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
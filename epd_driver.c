@@ -4,6 +4,8 @@
 
 #include "epd_driver.h"
 #include "ed047tc1.h"
+#include "i2s_data_bus.h"
+#include "row_prefetch.h"
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
@@ -13,6 +15,7 @@
 #include <esp_assert.h>
 #include <esp_heap_caps.h>
 #include <esp_log.h>
+#include <esp_memory_utils.h>
 #include <esp_types.h>
 #include <xtensa/core-macros.h>
 
@@ -49,7 +52,14 @@ typedef struct
     SemaphoreHandle_t done_smphr;
     Rect_t area;
     int32_t frame;
+    /// First frame not yet applied to the conversion LUT.
+    int32_t lut_from;
+    /// Drive time of the frame, including merged frames.
+    int32_t time;
     DrawMode_t mode;
+    bool prefetch;
+    /// Per-row gray range of the image, see `scan_row_ranges`.
+    const uint8_t *row_ranges;
 } OutputParams;
 
 /******************************************************************************/
@@ -57,9 +67,12 @@ typedef struct
 /******************************************************************************/
 
 /**
- * @brief Reorder the output buffer to account for I2S FIFO order.
+ * @brief Get a constant clear / darken row for an area, in wire order.
+ *
+ * @note Each pixel is placed with `I2S_WIRE_BYTE_INDEX`, so partial areas
+ *       are cleared exactly up to their edges.
  */
-static void reorder_line_buffer(uint32_t *line_data);
+static const uint8_t *constant_row(Rect_t area, int32_t color);
 
 /**
  * @brief output a row to the display.
@@ -69,7 +82,7 @@ static void write_row(uint32_t output_time_dus);
 /**
  * @brief skip a display row
  */
-static void skip_row(uint8_t pipeline_finish_time);
+static void skip_row(uint32_t pipeline_finish_time);
 
 static void IRAM_ATTR reset_lut(uint8_t *lut_mem, DrawMode_t mode);
 
@@ -82,6 +95,29 @@ static void IRAM_ATTR bit_shift_buffer_right(uint8_t *buf, uint32_t len, int32_t
 
 static void IRAM_ATTR nibble_shift_buffer_right(uint8_t *buf, uint32_t len);
 
+/**
+ * @brief Compute the darkest (low nibble) and lightest (high nibble) gray
+ *        level of every display row covered by an image.
+ */
+static void IRAM_ATTR scan_row_ranges(Rect_t area, const uint8_t *data,
+                                      uint8_t *ranges, uint32_t *histogram);
+
+/**
+ * @brief Select the frames to output for an image with a given histogram.
+ *
+ * Frames which change no pixel are dropped, frames driving the same pixels
+ * as their successor are merged into it by adding up the drive times.
+ *
+ * @return The number of planned frames.
+ */
+static int32_t plan_frames(const uint32_t *histogram, DrawMode_t mode,
+                           uint8_t *frames, int32_t *times);
+
+/**
+ * @brief Returns true if no pixel of a row changes in a frame.
+ */
+static inline bool row_is_noop(uint8_t range, int32_t frame, DrawMode_t mode);
+
 static void IRAM_ATTR provide_out(OutputParams *params);
 
 static void IRAM_ATTR feed_display(OutputParams *params);
@@ -112,39 +148,53 @@ static const int32_t contrast_cycles_4_white[15] = {10, 10, 8, 8, 8, 8, 8, 10, 1
 static uint8_t *conversion_lut;
 static QueueHandle_t output_queue;
 
+/**
+ * @brief Gray range per display row of the image being drawn.
+ */
+static uint8_t row_gray_ranges[EPD_HEIGHT];
+
+/**
+ * @brief Cached constant rows for `epd_push_pixels`, indexed by color.
+ */
+static uint8_t constant_rows[2][EPD_LINE_BYTES];
+static Rect_t constant_row_area[2] = {{.width = -1}, {.width = -1}};
+
+/**
+ * @brief Maps 8 pixels (LSB first) to two wire order bytes.
+ */
 static const DRAM_ATTR uint32_t lut_1bpp[256] = {
-    0x0000, 0x0001, 0x0004, 0x0005, 0x0010, 0x0011, 0x0014, 0x0015,
-    0x0040, 0x0041, 0x0044, 0x0045, 0x0050, 0x0051, 0x0054, 0x0055,
-    0x0100, 0x0101, 0x0104, 0x0105, 0x0110, 0x0111, 0x0114, 0x0115,
-    0x0140, 0x0141, 0x0144, 0x0145, 0x0150, 0x0151, 0x0154, 0x0155,
-    0x0400, 0x0401, 0x0404, 0x0405, 0x0410, 0x0411, 0x0414, 0x0415,
-    0x0440, 0x0441, 0x0444, 0x0445, 0x0450, 0x0451, 0x0454, 0x0455,
-    0x0500, 0x0501, 0x0504, 0x0505, 0x0510, 0x0511, 0x0514, 0x0515,
-    0x0540, 0x0541, 0x0544, 0x0545, 0x0550, 0x0551, 0x0554, 0x0555,
-    0x1000, 0x1001, 0x1004, 0x1005, 0x1010, 0x1011, 0x1014, 0x1015,
-    0x1040, 0x1041, 0x1044, 0x1045, 0x1050, 0x1051, 0x1054, 0x1055,
-    0x1100, 0x1101, 0x1104, 0x1105, 0x1110, 0x1111, 0x1114, 0x1115,
-    0x1140, 0x1141, 0x1144, 0x1145, 0x1150, 0x1151, 0x1154, 0x1155,
-    0x1400, 0x1401, 0x1404, 0x1405, 0x1410, 0x1411, 0x1414, 0x1415,
-    0x1440, 0x1441, 0x1444, 0x1445, 0x1450, 0x1451, 0x1454, 0x1455,
-    0x1500, 0x1501, 0x1504, 0x1505, 0x1510, 0x1511, 0x1514, 0x1515,
-    0x1540, 0x1541, 0x1544, 0x1545, 0x1550, 0x1551, 0x1554, 0x1555,
-    0x4000, 0x4001, 0x4004, 0x4005, 0x4010, 0x4011, 0x4014, 0x4015,
-    0x4040, 0x4041, 0x4044, 0x4045, 0x4050, 0x4051, 0x4054, 0x4055,
-    0x4100, 0x4101, 0x4104, 0x4105, 0x4110, 0x4111, 0x4114, 0x4115,
-    0x4140, 0x4141, 0x4144, 0x4145, 0x4150, 0x4151, 0x4154, 0x4155,
-    0x4400, 0x4401, 0x4404, 0x4405, 0x4410, 0x4411, 0x4414, 0x4415,
-    0x4440, 0x4441, 0x4444, 0x4445, 0x4450, 0x4451, 0x4454, 0x4455,
-    0x4500, 0x4501, 0x4504, 0x4505, 0x4510, 0x4511, 0x4514, 0x4515,
-    0x4540, 0x4541, 0x4544, 0x4545, 0x4550, 0x4551, 0x4554, 0x4555,
-    0x5000, 0x5001, 0x5004, 0x5005, 0x5010, 0x5011, 0x5014, 0x5015,
-    0x5040, 0x5041, 0x5044, 0x5045, 0x5050, 0x5051, 0x5054, 0x5055,
-    0x5100, 0x5101, 0x5104, 0x5105, 0x5110, 0x5111, 0x5114, 0x5115,
-    0x5140, 0x5141, 0x5144, 0x5145, 0x5150, 0x5151, 0x5154, 0x5155,
-    0x5400, 0x5401, 0x5404, 0x5405, 0x5410, 0x5411, 0x5414, 0x5415,
-    0x5440, 0x5441, 0x5444, 0x5445, 0x5450, 0x5451, 0x5454, 0x5455,
-    0x5500, 0x5501, 0x5504, 0x5505, 0x5510, 0x5511, 0x5514, 0x5515,
-    0x5540, 0x5541, 0x5544, 0x5545, 0x5550, 0x5551, 0x5554, 0x5555
+    0x0000, 0x0040, 0x0010, 0x0050, 0x0004, 0x0044, 0x0014, 0x0054,
+    0x0001, 0x0041, 0x0011, 0x0051, 0x0005, 0x0045, 0x0015, 0x0055,
+    0x4000, 0x4040, 0x4010, 0x4050, 0x4004, 0x4044, 0x4014, 0x4054,
+    0x4001, 0x4041, 0x4011, 0x4051, 0x4005, 0x4045, 0x4015, 0x4055,
+    0x1000, 0x1040, 0x1010, 0x1050, 0x1004, 0x1044, 0x1014, 0x1054,
+    0x1001, 0x1041, 0x1011, 0x1051, 0x1005, 0x1045, 0x1015, 0x1055,
+    0x5000, 0x5040, 0x5010, 0x5050, 0x5004, 0x5044, 0x5014, 0x5054,
+    0x5001, 0x5041, 0x5011, 0x5051, 0x5005, 0x5045, 0x5015, 0x5055,
+    0x0400, 0x0440, 0x0410, 0x0450, 0x0404, 0x0444, 0x0414, 0x0454,
+    0x0401, 0x0441, 0x0411, 0x0451, 0x0405, 0x0445, 0x0415, 0x0455,
+    0x4400, 0x4440, 0x4410, 0x4450, 0x4404, 0x4444, 0x4414, 0x4454,
+    0x4401, 0x4441, 0x4411, 0x4451, 0x4405, 0x4445, 0x4415, 0x4455,
+    0x1400, 0x1440, 0x1410, 0x1450, 0x1404, 0x1444, 0x1414, 0x1454,
+    0x1401, 0x1441, 0x1411, 0x1451, 0x1405, 0x1445, 0x1415, 0x1455,
+    0x5400, 0x5440, 0x5410, 0x5450, 0x5404, 0x5444, 0x5414, 0x5454,
+    0x5401, 0x5441, 0x5411, 0x5451, 0x5405, 0x5445, 0x5415, 0x5455,
+    0x0100, 0x0140, 0x0110, 0x0150, 0x0104, 0x0144, 0x0114, 0x0154,
+    0x0101, 0x0141, 0x0111, 0x0151, 0x0105, 0x0145, 0x0115, 0x0155,
+    0x4100, 0x4140, 0x4110, 0x4150, 0x4104, 0x4144, 0x4114, 0x4154,
+    0x4101, 0x4141, 0x4111, 0x4151, 0x4105, 0x4145, 0x4115, 0x4155,
+    0x1100, 0x1140, 0x1110, 0x1150, 0x1104, 0x1144, 0x1114, 0x1154,
+    0x1101, 0x1141, 0x1111, 0x1151, 0x1105, 0x1145, 0x1115, 0x1155,
+    0x5100, 0x5140, 0x5110, 0x5150, 0x5104, 0x5144, 0x5114, 0x5154,
+    0x5101, 0x5141, 0x5111, 0x5151, 0x5105, 0x5145, 0x5115, 0x5155,
+    0x0500, 0x0540, 0x0510, 0x0550, 0x0504, 0x0544, 0x0514, 0x0554,
+    0x0501, 0x0541, 0x0511, 0x0551, 0x0505, 0x0545, 0x0515, 0x0555,
+    0x4500, 0x4540, 0x4510, 0x4550, 0x4504, 0x4544, 0x4514, 0x4554,
+    0x4501, 0x4541, 0x4511, 0x4551, 0x4505, 0x4545, 0x4515, 0x4555,
+    0x1500, 0x1540, 0x1510, 0x1550, 0x1504, 0x1544, 0x1514, 0x1554,
+    0x1501, 0x1541, 0x1511, 0x1551, 0x1505, 0x1545, 0x1515, 0x1555,
+    0x5500, 0x5540, 0x5510, 0x5550, 0x5504, 0x5544, 0x5514, 0x5554,
+    0x5501, 0x5541, 0x5511, 0x5551, 0x5505, 0x5545, 0x5515, 0x5555
 };
 
 /******************************************************************************/
@@ -159,20 +209,13 @@ void epd_init()
     conversion_lut = (uint8_t *)heap_caps_malloc(1 << 16, MALLOC_CAP_8BIT);
     assert(conversion_lut != NULL);
     output_queue = xQueueCreate(64, EPD_WIDTH / 2);
+    row_prefetch_init();
 }
 
 
 void epd_push_pixels(Rect_t area, int16_t time, int32_t color)
 {
-    uint8_t row[EPD_LINE_BYTES] = { 0 };
-
-    for (uint32_t i = 0; i < area.width; i++)
-    {
-        uint32_t position = i + area.x % 4;
-        uint8_t mask = (color ? CLEAR_BYTE : DARK_BYTE) & (0b00000011 << (2 * (position % 4)));
-        row[area.x / 4 + position / 4] |= mask;
-    }
-    reorder_line_buffer((uint32_t *)row);
+    const uint8_t *row = constant_row(area, color);
 
     epd_start_frame();
 
@@ -255,25 +298,18 @@ void IRAM_ATTR calc_epd_input_4bpp(uint32_t *line_data, uint8_t *epd_input,
     uint32_t *wide_epd_input = (uint32_t *)epd_input;
     uint16_t *line_data_16 = (uint16_t *)line_data;
 
-    // this is reversed for little-endian, but this is later compensated
-    // through the output peripheral.
+    // the lookup table yields wire order bytes, which are placed at their
+    // final position in the DMA buffer.
     for (uint32_t j = 0; j < EPD_WIDTH / 16; j++)
     {
         uint16_t v1 = *(line_data_16++);
         uint16_t v2 = *(line_data_16++);
         uint16_t v3 = *(line_data_16++);
         uint16_t v4 = *(line_data_16++);
-#if USER_I2S_REG
-        uint32_t pixel = conversion_lut[v1] << 16 |
-                         conversion_lut[v2] << 24 |
-                         conversion_lut[v3] |
-                         conversion_lut[v4] << 8;
-#else
-        uint32_t pixel = (conversion_lut[v1]) << 0  |
-                         (conversion_lut[v2]) << 8  |
-                         (conversion_lut[v3]) << 16 |
-                         (conversion_lut[v4]) << 24;
-#endif
+        uint32_t pixel = conversion_lut[v1] << I2S_WIRE_BYTE_SHIFT(0) |
+                         conversion_lut[v2] << I2S_WIRE_BYTE_SHIFT(1) |
+                         conversion_lut[v3] << I2S_WIRE_BYTE_SHIFT(2) |
+                         conversion_lut[v4] << I2S_WIRE_BYTE_SHIFT(3);
         wide_epd_input[j] = pixel;
     }
 }
@@ -284,13 +320,14 @@ void IRAM_ATTR calc_epd_input_1bpp(uint8_t *line_data, uint8_t *epd_input,
 {
     uint32_t *wide_epd_input = (uint32_t *)epd_input;
 
-    // this is reversed for little-endian, but this is later compensated
-    // through the output peripheral.
+    // each lookup yields two wire order bytes, placed at their final
+    // position in the DMA buffer.
     for (uint32_t j = 0; j < EPD_WIDTH / 16; j++)
     {
         uint8_t v1 = *(line_data++);
         uint8_t v2 = *(line_data++);
-        wide_epd_input[j] = (lut_1bpp[v1] << 16) | lut_1bpp[v2];
+        wide_epd_input[j] = (lut_1bpp[v1] << I2S_WIRE_BYTE_SHIFT(0)) |
+                            (lut_1bpp[v2] << I2S_WIRE_BYTE_SHIFT(2));
     }
 }
 
@@ -631,6 +668,17 @@ void epd_copy_to_framebuffer(Rect_t image_area, uint8_t *image_data,
 {
     assert(image_data != NULL || framebuffer != NULL);
 
+    // full width images on screen are a contiguous block of the framebuffer.
+    if (image_area.x == 0 && image_area.width == EPD_WIDTH &&
+        image_area.y >= 0 && image_area.y + image_area.height <= EPD_HEIGHT)
+    {
+        // a synchronous copy, waiting on the DMA engine would also wait for
+        // its unrelated jobs. Background copies use epd_fb_dma_copy().
+        memcpy(&framebuffer[image_area.y * EPD_WIDTH / 2], image_data,
+               image_area.height * EPD_WIDTH / 2);
+        return;
+    }
+
     for (uint32_t i = 0; i < image_area.width * image_area.height; i++)
     {
         uint32_t value_index = i;
@@ -761,28 +809,90 @@ void IRAM_ATTR epd_draw_frame_1bit(Rect_t area, uint8_t *ptr,
 }
 
 
+void epd_image_histogram(Rect_t area, const uint8_t *data,
+                         uint32_t *histogram)
+{
+    uint32_t stride = area.width / 2 + area.width % 2;
+    memset(histogram, 0, 16 * sizeof(uint32_t));
+    for (int32_t y = 0; y < area.height; y++)
+    {
+        const uint8_t *p = data + y * stride;
+        for (uint32_t b = 0; b < (uint32_t)area.width / 2; b++)
+        {
+            histogram[p[b] & 0x0F]++;
+            histogram[p[b] >> 4]++;
+        }
+        if (area.width % 2)
+        {
+            histogram[p[stride - 1] & 0x0F]++;
+        }
+    }
+}
+
+
 void IRAM_ATTR epd_draw_image(Rect_t area, uint8_t *data, DrawMode_t mode)
 {
-    uint8_t frame_count = 15;
+    epd_draw_image_histogram(area, data, mode, NULL);
+}
+
+
+void IRAM_ATTR epd_draw_image_histogram(Rect_t area, uint8_t *data,
+                                        DrawMode_t mode,
+                                        const uint32_t *histogram)
+{
+    // rows in external memory are prefetched into internal memory by DMA,
+    // which needs the image to be written back from the cache first. Without
+    // DMA the prefetch would only add a CPU copy, rows are read in place.
+    bool prefetch = esp_ptr_external_ram(data) && row_prefetch_uses_dma();
+    if (prefetch)
+    {
+        row_prefetch_sync(data, (area.width / 2 + area.width % 2) * area.height);
+    }
+
+    // rows whose pixels are all done in a frame are skipped in that frame,
+    // the histogram is collected on the way if the caller has none.
+    uint32_t image_histogram[16] = {0};
+    if (histogram != NULL)
+    {
+        memcpy(image_histogram, histogram, sizeof(image_histogram));
+    }
+    scan_row_ranges(area, data, row_gray_ranges,
+                    histogram == NULL ? image_histogram : NULL);
+
+    // pixels next to a partial area are padded white by the producer.
+    if (area.width != EPD_WIDTH || area.x != 0)
+    {
+        image_histogram[15]++;
+    }
+
+    uint8_t frames[15];
+    int32_t times[15];
+    int32_t frame_count = plan_frames(image_histogram, mode, frames, times);
 
     SemaphoreHandle_t fetch_sem = xSemaphoreCreateBinary();
     SemaphoreHandle_t feed_sem = xSemaphoreCreateBinary();
     vTaskDelay(10);
-    for (uint8_t k = 0; k < frame_count; k++)
+    for (int32_t n = 0; n < frame_count; n++)
     {
         OutputParams p1 = {
             .area = area,
             .data_ptr = data,
-            .frame = k,
+            .frame = frames[n],
+            .lut_from = n == 0 ? 0 : frames[n - 1] + 1,
+            .time = times[n],
             .mode = mode,
             .done_smphr = fetch_sem,
+            .prefetch = prefetch,
+            .row_ranges = row_gray_ranges,
         };
         OutputParams p2 = {
             .area = area,
             .data_ptr = data,
-            .frame = k,
+            .frame = frames[n],
+            .time = times[n],
             .mode = mode,
             .done_smphr = feed_sem,
+            .row_ranges = row_gray_ranges,
         };
 
         TaskHandle_t t1, t2;
@@ -818,7 +928,7 @@ static void write_row(uint32_t output_time_dus)
 }
 
 
-static void skip_row(uint8_t pipeline_finish_time)
+static void skip_row(uint32_t pipeline_finish_time)
 {
     // output previously loaded row, fill buffer with no-ops.
     if (skipping == 0)
@@ -850,13 +960,27 @@ static void skip_row(uint8_t pipeline_finish_time)
 }
 
 
-static void reorder_line_buffer(uint32_t *line_data)
+static const uint8_t *constant_row(Rect_t area, int32_t color)
 {
-    for (uint32_t i = 0; i < EPD_LINE_BYTES / 4; i++)
+    color = color ? 1 : 0;
+    uint8_t *row = constant_rows[color];
+    Rect_t *cached = &constant_row_area[color];
+    if (cached->x == area.x && cached->width == area.width)
+    {
+        return row;
+    }
+
+    memset(row, 0, EPD_LINE_BYTES);
+    uint8_t pattern = color ? CLEAR_BYTE : DARK_BYTE;
+    int32_t start = area.x < 0 ? 0 : area.x;
+    int32_t end = area.x + area.width > EPD_WIDTH ? EPD_WIDTH : area.x + area.width;
+    for (int32_t i = start; i < end; i++)
     {
-        uint32_t val = *line_data;
-        *(line_data++) = val >> 16 | ((val & 0x0000FFFF) << 16);
+        uint8_t mask = 0b00000011 << I2S_WIRE_PIXEL_SHIFT(i % 4);
+        row[I2S_WIRE_BYTE_INDEX(i / 4)] |= pattern & mask;
     }
+    *cached = area;
+    return row;
 }
 
 
@@ -886,29 +1010,30 @@ static void IRAM_ATTR update_LUT(uint8_t *lut_mem, uint8_t k, DrawMode_t mode)
     }
 
     // reset the pixels which are not to be lightened / darkened
-    // any longer in the current frame
+    // any longer in the current frame. The first pixel (lowest nibble)
+    // goes to the most significant bits of the wire order byte.
     for (uint32_t l = k; l < (1 << 16); l += 16)
     {
-        lut_mem[l] &= 0xFC;
+        lut_mem[l] &= ~(0b11 << I2S_WIRE_PIXEL_SHIFT(0));
     }
 
     for (uint32_t l = (k << 4); l < (1 << 16); l += (1 << 8))
     {
         for (uint32_t p = 0; p < 16; p++)
         {
-            lut_mem[l + p] &= 0xF3;
+            lut_mem[l + p] &= ~(0b11 << I2S_WIRE_PIXEL_SHIFT(1));
         }
     }
     for (uint32_t l = (k << 8); l < (1 << 16); l += (1 << 12))
     {
         for (uint32_t p = 0; p < (1 << 8); p++)
         {
-            lut_mem[l + p] &= 0xCF;
+            lut_mem[l + p] &= ~(0b11 << I2S_WIRE_PIXEL_SHIFT(2));
         }
     }
     for (uint32_t p = (k << 12); p < ((k + 1) << 12); p++)
     {
-        lut_mem[p] &= 0x3F;
+        lut_mem[p] &= ~(0b11 << I2S_WIRE_PIXEL_SHIFT(3));
     }
 }
 
@@ -935,6 +1060,114 @@ static void IRAM_ATTR nibble_shift_buffer_right(uint8_t *buf, uint32_t len)
     }
 }
 
+static void IRAM_ATTR scan_row_ranges(Rect_t area, const uint8_t *data,
+                                      uint8_t *ranges, uint32_t *histogram)
+{
+    uint32_t stride = area.width / 2 + area.width % 2;
+    // pixels next to a partial area are padded white by the producer.
+    bool full_width = area.width == EPD_WIDTH && area.x == 0;
+
+    for (int32_t i = 0; i < EPD_HEIGHT; i++)
+    {
+        int32_t row = i - area.y;
+        if (row < 0 || row >= area.height)
+        {
+            // not part of the image, never driven.
+            ranges[i] = 0x0F;
+            continue;
+        }
+
+        const uint8_t *p = data + row * stride;
+        uint8_t lo = 15;
+        uint8_t hi = full_width ? 0 : 15;
+        for (uint32_t b = 0; b < (uint32_t)area.width / 2; b++)
+        {
+            uint8_t v1 = p[b] & 0x0F;
+            uint8_t v2 = p[b] >> 4;
+            lo = v1 < lo ? v1 : lo;
+            lo = v2 < lo ? v2 : lo;
+            hi = v1 > hi ? v1 : hi;
+            hi = v2 > hi ? v2 : hi;
+            if (histogram != NULL)
+            {
+                histogram[v1]++;
+                histogram[v2]++;
+            }
+            else if (lo == 0 && hi == 15)
+            {
+                break;
+            }
+        }
+        // the padding nibble of uneven widths is not part of the image.
+        if (area.width % 2)
+        {
+            uint8_t v = p[stride - 1] & 0x0F;
+            lo = v < lo ? v : lo;
+            hi = v > hi ? v : hi;
+            if (histogram != NULL)
+            {
+                histogram[v]++;
+            }
+        }
+        ranges[i] = lo | (hi << 4);
+    }
+}
+
+
+static inline bool row_is_noop(uint8_t range, int32_t frame, DrawMode_t mode)
+{
+    // frame k stops driving gray level 15 - k (white ink: level k),
+    // see `update_LUT`.
+    if (mode == WHITE_ON_BLACK)
+    {
+        return (range >> 4) <= frame;
+    }
+    return (range & 0x0F) >= 15 - frame;
+}
+
+
+static int32_t plan_frames(const uint32_t *histogram, DrawMode_t mode,
+                           uint8_t *frames, int32_t *times)
+{
+    const int32_t *contrast_lut = mode == WHITE_ON_BLACK
+                                      ? contrast_cycles_4_white
+                                      : contrast_cycles_4;
+
+    // pixels still driven in the current frame, see `update_LUT`.
+    uint32_t driven = 0;
+    for (int32_t l = 0; l < 16; l++)
+    {
+        driven += histogram[l];
+    }
+
+    int32_t count = 0;
+    int32_t time = 0;
+    for (int32_t k = 0; k < 15; k++)
+    {
+        // gray level which is driven in frame k, but not in frame k + 1.
+        int32_t level = mode == WHITE_ON_BLACK ? k + 1 : 14 - k;
+        // level not driven at all.
+        int32_t done = mode == WHITE_ON_BLACK ? k : 15 - k;
+        driven -= histogram[done];
+        if (driven == 0)
+        {
+            break;
+        }
+
+        time += contrast_lut[k];
+        if (k < 14 && histogram[level] == 0)
+        {
+            continue;
+        }
+        frames[count] = k;
+        times[count] = time;
+        count++;
+        time = 0;
+    }
+    return count;
+}
+
+
 static void IRAM_ATTR provide_out(OutputParams *params)
 {
     uint8_t line[EPD_WIDTH / 2];
@@ -942,12 +1175,16 @@ static void IRAM_ATTR provide_out(OutputParams *params)
     Rect_t area = params->area;
     uint8_t *ptr = params->data_ptr;
 
-    if (params->frame == 0)
+    if (params->lut_from == 0)
     {
         reset_lut(conversion_lut, params->mode);
     }
 
-    update_LUT(conversion_lut, params->frame, params->mode);
+    // catch up on frames merged into this one.
+    for (int32_t k = params->lut_from; k <= params->frame; k++)
+    {
+        update_LUT(conversion_lut, k, params->mode);
+    }
 
     if (area.x < 0)
     {
@@ -958,6 +1195,31 @@ static void IRAM_ATTR provide_out(OutputParams *params)
         ptr += (area.width / 2 + area.width % 2) * -area.y;
     }
 
+    bool full_width = area.width == EPD_WIDTH && area.x == 0;
+    uint8_t *buf_start = (uint8_t *)line;
+    uint32_t line_bytes = area.width / 2 + area.width % 2;
+    if (area.x >= 0)
+    {
+        buf_start += area.x / 2;
+    }
+    else
+    {
+        // reduce line_bytes to actually used bytes
+        line_bytes += area.x / 2;
+    }
+    line_bytes =
+        min(line_bytes, EPD_WIDTH / 2 - (uint32_t)(buf_start - line));
+
+    if (params->prefetch)
+    {
+        int32_t first = area.y < 0 ? 0 : area.y;
+        int32_t last = area.y + area.height > EPD_HEIGHT ? EPD_HEIGHT
+                                                         : area.y + area.height;
+        row_prefetch_begin(ptr, area.width / 2 + area.width % 2,
+                           full_width ? EPD_WIDTH / 2 : line_bytes,
+                           last - first);
+    }
+
     for (int32_t i = 0; i < EPD_HEIGHT; i++)
     {
         if (i < area.y || i >= area.y + area.height)
@@ -965,29 +1227,30 @@ static void IRAM_ATTR provide_out(OutputParams *params)
             continue;
         }
 
+        // the consumer skips this row, too.
+        if (row_is_noop(params->row_ranges[i], params->frame, params->mode))
+        {
+            if (params->prefetch)
+            {
+                row_prefetch_skip();
+            }
+            ptr += area.width / 2 + area.width % 2;
+            continue;
+        }
+
+        // rows from external memory are read from the internal prefetch copy.
+        const uint8_t *src = params->prefetch ? row_prefetch_next() : ptr;
+
         uint32_t *lp;
         bool shifted = false;
-        if (area.width == EPD_WIDTH && area.x == 0)
+        if (full_width)
         {
-            lp = (uint32_t *)ptr;
+            lp = (uint32_t *)src;
             ptr += EPD_WIDTH / 2;
         }
         else
         {
-            uint8_t *buf_start = (uint8_t *)line;
-            uint32_t line_bytes = area.width / 2 + area.width % 2;
-            if (area.x >= 0)
-            {
-                buf_start += area.x / 2;
-            }
-            else
-            {
-                // reduce line_bytes to actually used bytes
-                line_bytes += area.x / 2;
-            }
-            line_bytes =
-                min(line_bytes, EPD_WIDTH / 2 - (uint32_t)(buf_start - line));
-            memcpy(buf_start, ptr, line_bytes);
+            memcpy(buf_start, src, line_bytes);
             ptr += area.width / 2 + area.width % 2;
 
             // mask last nibble for uneven width
@@ -1012,6 +1275,11 @@ static void IRAM_ATTR provide_out(OutputParams *params)
         }
     }
 
+    if (params->prefetch)
+    {
+        row_prefetch_end();
+    }
+
     xSemaphoreGive(params->done_smphr);
     vTaskDelay(portMAX_DELAY);
 }
@@ -1020,37 +1288,27 @@ static void IRAM_ATTR provide_out(OutputParams *params)
 static void IRAM_ATTR feed_display(OutputParams *params)
 {
     Rect_t area = params->area;
-    const int32_t *contrast_lut = contrast_cycles_4;
-    switch (params->mode)
-    {
-    case WHITE_ON_WHITE:
-    case BLACK_ON_WHITE:
-        contrast_lut = contrast_cycles_4;
-        break;
-    case WHITE_ON_BLACK:
-        contrast_lut = contrast_cycles_4_white;
-        break;
-    }
 
     epd_start_frame();
     // uint8_t output[EPD_WIDTH / 2];
     for (int32_t i = 0; i < EPD_HEIGHT; i++)
     {
-        if (i < area.y || i >= area.y + area.height)
+        if (i < area.y || i >= area.y + area.height ||
+            row_is_noop(params->row_ranges[i], params->frame, params->mode))
         {
-            skip_row(contrast_lut[params->frame]);
+            skip_row(params->time);
             continue;
         }
         uint8_t output[EPD_WIDTH / 2];
         xQueueReceive(output_queue, output, portMAX_DELAY);
         calc_epd_input_4bpp((uint32_t *)output, epd_get_current_buffer(),
                             params->frame, conversion_lut);
-        write_row(contrast_lut[params->frame]);
+        write_row(params->time);
     }
     if (!skipping)
     {
         // Since we "pipeline" row output, we still have to latch out the last row.
-        write_row(contrast_lut[params->frame]);
+        write_row(params->time);
     }
     epd_end_frame();
 
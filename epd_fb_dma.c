@@ -0,0 +1,416 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_fb_dma.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <esp_assert.h>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+#include <esp_log.h>
+#include <esp_memory_utils.h>
+#include <soc/soc_caps.h>
+
+#include <string.h>
+
+#if SOC_GDMA_SUPPORTED && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#define EPD_FB_DMA_USE_DMA 1
+#include <esp_async_memcpy.h>
+#include <esp_cache.h>
+#else
+#define EPD_FB_DMA_USE_DMA 0
+#endif
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Alignment of DMA blocks. Covers the external memory cache line.
+ */
+#define DMA_ALIGN 64
+
+/**
+ * @brief Bytes per DMA transaction, fits into a single descriptor.
+ */
+#define DMA_CHUNK (63 * DMA_ALIGN)
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    bool used;
+    /// The job reads from the fill pattern block.
+    bool uses_pattern;
+    /// Outstanding DMA transactions.
+    volatile uint32_t pending;
+    /// DMA body of the destination, invalidated when the job is done.
+    uint8_t *dst;
+    uint32_t len;
+    epd_fb_dma_cb_t cb;
+    void *arg;
+} fb_dma_job_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Split an operation into CPU head / tail and a DMA body.
+ *
+ * @param src Source buffer, or NULL for a fill from the pattern block.
+ */
+static void submit(uint8_t *dst, const uint8_t *src, uint8_t value,
+                   uint32_t len, epd_fb_dma_cb_t cb, void *arg);
+
+#if EPD_FB_DMA_USE_DMA
+static fb_dma_job_t *acquire_job(uint8_t *dst, uint32_t len,
+                                 bool uses_pattern, epd_fb_dma_cb_t cb,
+                                 void *arg);
+
+/**
+ * @brief Drop one reference of a job, finish it on the last one.
+ */
+static void IRAM_ATTR release_job(fb_dma_job_t *job, bool from_isr);
+
+static bool IRAM_ATTR chunk_done(async_memcpy_handle_t handle,
+                                 async_memcpy_event_t *event, void *args);
+
+/**
+ * @brief Make a block coherent with the DMA engine before a transfer.
+ */
+static void cache_sync(const uint8_t *ptr, uint32_t len, bool invalidate);
+
+/**
+ * @brief Drop cache lines the CPU may have loaded while the DMA engine wrote.
+ */
+static void IRAM_ATTR cache_invalidate(const uint8_t *ptr, uint32_t len);
+#endif
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "epd_fb_dma";
+
+#if EPD_FB_DMA_USE_DMA
+static async_memcpy_handle_t memcpy_handle = NULL;
+
+/**
+ * @brief Source block for fills, holds `pattern_value`.
+ */
+static uint8_t *pattern;
+static int32_t pattern_value = -1;
+static uint32_t pattern_users;
+/**
+ * @brief Serializes fill submissions, from the pattern check to the job.
+ */
+static SemaphoreHandle_t pattern_lock;
+
+static fb_dma_job_t jobs[EPD_FB_DMA_MAX_JOBS];
+static volatile uint32_t active_jobs;
+static portMUX_TYPE job_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+
+static bool initialized = false;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void epd_fb_dma_init()
+{
+    if (initialized)
+    {
+        return;
+    }
+    initialized = true;
+
+#if EPD_FB_DMA_USE_DMA
+    pattern = (uint8_t *)heap_caps_aligned_alloc(
+        DMA_ALIGN, DMA_CHUNK, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    assert(pattern != NULL);
+    pattern_lock = xSemaphoreCreateMutex();
+    assert(pattern_lock != NULL);
+
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.backlog = 16;
+    config.psram_trans_align = DMA_ALIGN;
+    config.sram_trans_align = 4;
+    if (esp_async_memcpy_install(&config, &memcpy_handle) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "async memcpy unavailable, using the CPU");
+        memcpy_handle = NULL;
+    }
+#else
+    ESP_LOGI(TAG, "no GDMA on this target, using the CPU");
+#endif
+}
+
+
+void epd_fb_dma_fill(uint8_t *dst, uint8_t value, uint32_t len,
+                     epd_fb_dma_cb_t cb, void *arg)
+{
+    submit(dst, NULL, value, len, cb, arg);
+}
+
+
+void epd_fb_dma_copy(uint8_t *dst, const uint8_t *src, uint32_t len,
+                     epd_fb_dma_cb_t cb, void *arg)
+{
+    assert(src != NULL);
+    submit(dst, src, 0, len, cb, arg);
+}
+
+
+bool epd_fb_dma_busy()
+{
+#if EPD_FB_DMA_USE_DMA
+    return active_jobs > 0;
+#else
+    return false;
+#endif
+}
+
+
+void epd_fb_dma_wait()
+{
+    while (epd_fb_dma_busy())
+    {
+        vTaskDelay(1);
+    }
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static void submit(uint8_t *dst, const uint8_t *src, uint8_t value,
+                   uint32_t len, epd_fb_dma_cb_t cb, void *arg)
+{
+    assert(dst != NULL || len == 0);
+    epd_fb_dma_init();
+
+#if EPD_FB_DMA_USE_DMA
+    uint32_t head = (DMA_ALIGN - ((uint32_t)dst & (DMA_ALIGN - 1))) & (DMA_ALIGN - 1);
+    bool same_phase = src == NULL ||
+                      (((uint32_t)dst ^ (uint32_t)src) & (DMA_ALIGN - 1)) == 0;
+    if (memcpy_handle != NULL && same_phase && len >= EPD_FB_DMA_MIN_BYTES + head)
+    {
+        uint32_t body = (len - head) & ~(DMA_ALIGN - 1);
+        uint32_t tail = len - head - body;
+
+        // unaligned head and tail are done by the CPU.
+        if (src != NULL)
+        {
+            memcpy(dst, src, head);
+            memcpy(dst + head + body, src + head + body, tail);
+        }
+        else
+        {
+            memset(dst, value, head);
+            memset(dst + head + body, value, tail);
+        }
+
+        uint8_t *body_dst = dst + head;
+        const uint8_t *body_src = src != NULL ? src + head : NULL;
+        cache_sync(body_dst, body, true);
+
+        fb_dma_job_t *job;
+        if (body_src == NULL)
+        {
+            // the pattern block can only change while no fill is using it.
+            // the lock keeps other fills from taking it between the check
+            // and the job.
+            xSemaphoreTake(pattern_lock, portMAX_DELAY);
+            while (pattern_users > 0 && pattern_value != value)
+            {
+                vTaskDelay(1);
+            }
+            if (pattern_value != value)
+            {
+                memset(pattern, value, DMA_CHUNK);
+                pattern_value = value;
+            }
+            job = acquire_job(body_dst, body, true, cb, arg);
+            xSemaphoreGive(pattern_lock);
+        }
+        else
+        {
+            cache_sync(body_src, body, false);
+            job = acquire_job(body_dst, body, false, cb, arg);
+        }
+
+        for (uint32_t offset = 0; offset < body; offset += DMA_CHUNK)
+        {
+            uint32_t n = body - offset < DMA_CHUNK ? body - offset : DMA_CHUNK;
+            void *chunk_src = body_src != NULL ? (void *)(body_src + offset)
+                                               : (void *)pattern;
+
+            portENTER_CRITICAL(&job_lock);
+            job->pending++;
+            portEXIT_CRITICAL(&job_lock);
+
+            // the transaction queue may be full, wait for it to drain.
+            while (esp_async_memcpy(memcpy_handle, body_dst + offset, chunk_src,
+                                    n, chunk_done, job) != ESP_OK)
+            {
+                vTaskDelay(1);
+            }
+        }
+
+        // drop the submission reference.
+        release_job(job, false);
+        return;
+    }
+#endif
+
+    if (src != NULL)
+    {
+        memcpy(dst, src, len);
+    }
+    else
+    {
+        memset(dst, value, len);
+    }
+    if (cb != NULL)
+    {
+        cb(arg);
+    }
+}
+
+
+#if EPD_FB_DMA_USE_DMA
+static fb_dma_job_t *acquire_job(uint8_t *dst, uint32_t len,
+                                 bool uses_pattern, epd_fb_dma_cb_t cb,
+                                 void *arg)
+{
+    while (true)
+    {
+        portENTER_CRITICAL(&job_lock);
+        for (int32_t i = 0; i < EPD_FB_DMA_MAX_JOBS; i++)
+        {
+            fb_dma_job_t *job = &jobs[i];
+            if (!job->used)
+            {
+                job->used = true;
+                job->uses_pattern = uses_pattern;
+                if (uses_pattern)
+                {
+                    pattern_users++;
+                }
+                // the submitting task holds one reference until all
+                // transactions are queued.
+                job->pending = 1;
+                job->dst = dst;
+                job->len = len;
+                job->cb = cb;
+                job->arg = arg;
+                active_jobs++;
+                portEXIT_CRITICAL(&job_lock);
+                return job;
+            }
+        }
+        portEXIT_CRITICAL(&job_lock);
+        vTaskDelay(1);
+    }
+}
+
+
+static void IRAM_ATTR release_job(fb_dma_job_t *job, bool from_isr)
+{
+    bool done;
+    if (from_isr)
+    {
+        portENTER_CRITICAL_ISR(&job_lock);
+    }
+    else
+    {
+        portENTER_CRITICAL(&job_lock);
+    }
+    done = --job->pending == 0;
+    epd_fb_dma_cb_t cb = job->cb;
+    void *arg = job->arg;
+    if (done && job->uses_pattern)
+    {
+        pattern_users--;
+    }
+    if (from_isr)
+    {
+        portEXIT_CRITICAL_ISR(&job_lock);
+    }
+    else
+    {
+        portEXIT_CRITICAL(&job_lock);
+    }
+
+    if (done)
+    {
+        // before the callback or epd_fb_dma_wait() let the CPU read it.
+        cache_invalidate(job->dst, job->len);
+        if (cb != NULL)
+        {
+            cb(arg);
+        }
+        portENTER_CRITICAL_SAFE(&job_lock);
+        job->used = false;
+        active_jobs--;
+        portEXIT_CRITICAL_SAFE(&job_lock);
+    }
+}
+
+
+static bool IRAM_ATTR chunk_done(async_memcpy_handle_t handle,
+                                 async_memcpy_event_t *event, void *args)
+{
+    release_job((fb_dma_job_t *)args, true);
+    return false;
+}
+
+
+static void cache_sync(const uint8_t *ptr, uint32_t len, bool invalidate)
+{
+    if (!esp_ptr_external_ram(ptr))
+    {
+        return;
+    }
+    // the DMA body is aligned to the cache line already.
+    int flags = ESP_CACHE_MSYNC_FLAG_DIR_C2M;
+    if (invalidate)
+    {
+        flags |= ESP_CACHE_MSYNC_FLAG_INVALIDATE;
+    }
+    esp_cache_msync((void *)ptr, len, flags);
+}
+
+
+static void IRAM_ATTR cache_invalidate(const uint8_t *ptr, uint32_t len)
+{
+    if (!esp_ptr_external_ram(ptr))
+    {
+        return;
+    }
+#ifdef ESP_CACHE_MSYNC_FLAG_DIR_M2C
+    esp_cache_msync((void *)ptr, len, ESP_CACHE_MSYNC_FLAG_DIR_M2C);
+#else
+    // the lines are clean since the sync before the transfer, so this only
+    // invalidates them.
+    esp_cache_msync((void *)ptr, len,
+                    ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE);
+#endif
+}
+#endif
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
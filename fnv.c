@@ -0,0 +1,55 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "fnv.h"
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define FNV1A_64_PRIME 0x100000001b3ull
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+uint64_t fnv1a_64(uint64_t hash, const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash = (hash ^ p[i]) * FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+
+uint64_t fnv1a_64_string(uint64_t hash, const char *string)
+{
+    for (const uint8_t *p = (const uint8_t *)string; *p; p++)
+    {
+        hash = (hash ^ *p) * FNV1A_64_PRIME;
+    }
+    return hash;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -3,7 +3,11 @@
 /***        include files                                                   ***/
 /******************************************************************************/
 
+#include "arena.h"
 #include "epd_driver.h"
+#include "glyph_cache.h"
+#include "text_cache.h"
+#include "utf8.h"
 
 #include <esp_assert.h>
 #include <esp_heap_caps.h>
@@ -18,18 +22,67 @@
 /***        macro definitions                                               ***/
 /******************************************************************************/
 
+/**
+ * @brief Number of fonts with a glyph index.
+ *
+ * Further fonts are looked up by binary search only.
+ */
+#ifndef FONT_INDEX_MAX_FONTS
+#define FONT_INDEX_MAX_FONTS 4
+#endif
+
+/**
+ * @brief Entries of the per-font code point cache, a power of two.
+ */
+#ifndef FONT_INDEX_CACHE_SIZE
+#define FONT_INDEX_CACHE_SIZE 64
+#endif
+
+/**
+ * @brief Code points below this are looked up in a direct table.
+ */
+#define FONT_INDEX_DIRECT_CPS 256
+
+/**
+ * @brief Glyphs shaped at once by the string drawing functions.
+ */
+#ifndef TEXT_RUN_CHUNK
+#define TEXT_RUN_CHUNK 64
+#endif
+
 /******************************************************************************/
 /***        type definitions                                                ***/
 /******************************************************************************/
 
 typedef struct
 {
-    uint8_t  mask;        /* char data will be bitwise AND with this */
-    uint8_t  lead;        /* start bytes of current char in utf-8 encoded character */
-    uint32_t beg;         /* beginning of codepoint range */
-    uint32_t end;         /* end of codepoint range */
-    int32_t  bits_stored; /* the number of bits from the codepoint that fits in char */
-} utf_t;
+    uint32_t cp;
+    GFXglyph *glyph;
+} glyph_cache_entry_t;
+
+/**
+ * @brief Glyph lookup tables of a font.
+ */
+typedef struct
+{
+    const GFXfont *font;
+    /// Glyph index + 1 of ASCII / Latin-1 code points, 0 if missing.
+    uint32_t direct[FONT_INDEX_DIRECT_CPS];
+    /// Direct-mapped cache of other code points, including misses.
+    glyph_cache_entry_t cache[FONT_INDEX_CACHE_SIZE];
+} font_index_t;
+
+/**
+ * @brief Mapping of glyph gray levels to buffer colors.
+ */
+typedef struct
+{
+    uint8_t color[16];
+    /// Both pixels of a glyph byte at once.
+    uint8_t pair[256];
+    /// Default colors: the buffer byte is the inverted glyph byte.
+    bool inverted;
+} glyph_colors_t;
 
 /******************************************************************************/
 /***        local function prototypes                                       ***/
@@ -45,34 +98,90 @@ static inline int32_t max(int32_t x, int32_t y)
     return x > y ? x : y;
 }
 
-static int32_t utf8_len(const uint8_t ch);
+/**
+ * @brief Get the glyph index of a font, build it on first use.
+ *
+ * @return The index, or NULL if all index slots are taken.
+ */
+static font_index_t *font_index(const GFXfont *font);
 
-static uint32_t next_cp(uint8_t **string);
+/**
+ * @brief Binary search of the font intervals.
+ */
+static GFXglyph *find_glyph(const GFXfont *font, uint32_t code_point);
 
 static FontProperties font_properties_default();
 
-static void IRAM_ATTR draw_char(const GFXfont *font,
-                                uint8_t *buffer,
-                                int32_t *cursor_x,
-                                int32_t cursor_y,
-                                uint16_t buf_width,
-                                uint16_t buf_height,
-                                uint32_t cp,
-                                const FontProperties *props);
+/**
+ * @brief Append a decoded code point to a run.
+ *
+ * @param bytes The encoded length of the code point.
+ */
+static void shape_code_point(TextRun *run, uint32_t cp, uint32_t bytes);
+
+/**
+ * @brief Extend the bounds of a run by a placed glyph.
+ */
+static void add_glyph_bounds(TextRun *run, const GlyphPosition *pos);
+
+/**
+ * @brief Build the glyph level to buffer color mapping of a text.
+ */
+static void glyph_colors_init(glyph_colors_t *colors,
+                              const FontProperties *props);
 
 /**
- * @brief Calculate the bounds of a character when drawn at (x, y), move the
- *        cursor (*x) forward, adjust the given bounds.
+ * @brief Render `n` glyph pixels starting at pixel `sx` of a glyph row to
+ *        pixel `dx` of a buffer row.
  */
-static void get_char_bounds(const GFXfont *font,
-                            uint32_t cp,
-                            int32_t *x,
-                            int32_t *y,
-                            int32_t *minx,
-                            int32_t *miny,
-                            int32_t *maxx,
-                            int32_t *maxy,
-                            const FontProperties *props);
+static void IRAM_ATTR blit_glyph_row(uint8_t *dst, int32_t dx,
+                                     const uint8_t *src, int32_t sx,
+                                     int32_t n, const glyph_colors_t *colors);
+
+/**
+ * @brief Fill a box of a buffer, clipped to the buffer.
+ */
+static void fill_box(uint8_t *buffer, int32_t buf_width, int32_t buf_height,
+                     const Rect_t *box, uint8_t color);
+
+/**
+ * @brief Draw a string through the rendered-string cache.
+ *
+ * @return false if the string is not cacheable and must be drawn directly.
+ */
+static bool write_cached(const GFXfont *font, const char *string,
+                         int32_t *cursor_x, int32_t *cursor_y,
+                         uint8_t *framebuffer, DrawMode_t mode,
+                         const FontProperties *properties);
+
+/**
+ * @brief Shape a string in runs of `TEXT_RUN_CHUNK` glyphs with its origin at
+ *        (x, y), rendering them into `buffer` if not NULL.
+ *
+ * @param bounds Extended by the bounds of the runs, clipped to the screen, if
+ *               not NULL. Empty bounds have a width of 0.
+ * @param pen_x  Set to the pen offset after the string.
+ */
+static void shape_chunks(const GFXfont *font, const char *string, int32_t x,
+                         int32_t y, const FontProperties *properties,
+                         uint8_t *buffer, const Rect_t *buffer_area,
+                         Rect_t *bounds, int32_t *pen_x, int32_t *pen_y);
+
+/**
+ * @brief Draw a run to a buffer, with the run origin at buffer position (x, y).
+ */
+static void IRAM_ATTR draw_run(const TextRun *run, uint8_t *buffer,
+                               int32_t x, int32_t y,
+                               int32_t buf_width, int32_t buf_height);
+
+static void IRAM_ATTR draw_glyph(const GFXfont *font,
+                                 const GFXglyph *glyph,
+                                 uint8_t *buffer,
+                                 int32_t pen_x,
+                                 int32_t pen_y,
+                                 int32_t buf_width,
+                                 int32_t buf_height,
+                                 const glyph_colors_t *colors);
 
 /******************************************************************************/
 /***        exported variables                                              ***/
@@ -82,20 +191,7 @@ static void get_char_bounds(const GFXfont *font,
 /***        local variables                                                 ***/
 /******************************************************************************/
 
-/**
- * @brief UTF-8 decode inspired from rosetta code
- *
- * https://rosettacode.org/wiki/UTF-8_encode_and_decode#C
- */
-static utf_t *utf[] = {
-    /*             mask        lead        beg      end       bits */
-    [0] = &(utf_t){0b00111111, 0b10000000, 0,       0,        6},
-    [1] = &(utf_t){0b01111111, 0b00000000, 0000,    0177,     7},
-    [2] = &(utf_t){0b00011111, 0b11000000, 0200,    03777,    5},
-    [3] = &(utf_t){0b00001111, 0b11100000, 04000,   0177777,  4},
-    [4] = &(utf_t){0b00000111, 0b11110000, 0200000, 04177777, 3},
-    &(utf_t){0},
-};
+static font_index_t *font_indices[FONT_INDEX_MAX_FONTS];
 
 /******************************************************************************/
 /***        exported functions                                              ***/
@@ -103,22 +199,185 @@ static utf_t *utf[] = {
 
 void get_glyph(const GFXfont *font, uint32_t code_point, GFXglyph **glyph)
 {
-    UnicodeInterval *intervals = font->intervals;
-    *glyph = NULL;
-    for (int32_t i = 0; i < font->interval_count; i++)
+    font_index_t *index = font_index(font);
+    if (index == NULL)
     {
-        UnicodeInterval *interval = &intervals[i];
-        if (code_point >= interval->first && code_point <= interval->last)
+        *glyph = find_glyph(font, code_point);
+        return;
+    }
+
+    if (code_point < FONT_INDEX_DIRECT_CPS)
+    {
+        uint32_t i = index->direct[code_point];
+        *glyph = i ? &font->glyph[i - 1] : NULL;
+        return;
+    }
+
+    glyph_cache_entry_t *entry =
+        &index->cache[code_point & (FONT_INDEX_CACHE_SIZE - 1)];
+    if (entry->cp != code_point)
+    {
+        entry->cp = code_point;
+        entry->glyph = find_glyph(font, code_point);
+    }
+    *glyph = entry->glyph;
+}
+
+
+void text_run_init(TextRun *run, const GFXfont *font, GlyphPosition *storage,
+                   uint32_t capacity, const FontProperties *props)
+{
+    run->font = font;
+    run->props = props == NULL ? font_properties_default() : *props;
+    run->glyphs = storage;
+    run->capacity = capacity;
+    run->count = 0;
+    run->bytes = 0;
+    run->pen_x = 0;
+    run->pen_y = 0;
+    run->min_x = INT32_MAX;
+    run->min_y = INT32_MAX;
+    run->max_x = INT32_MIN;
+    run->max_y = INT32_MIN;
+}
+
+
+const char *text_run_shape(TextRun *run, const char *string)
+{
+    while (*string != '\0' && run->count < run->capacity)
+    {
+        // plain ASCII needs no decoding, line feeds take no glyph slot.
+        uint32_t ascii = utf8_ascii_span(string, run->capacity - run->count);
+        for (uint32_t i = 0; i < ascii; i++)
         {
-            *glyph = &font->glyph[interval->offset + (code_point - interval->first)];
-            return;
+            shape_code_point(run, (uint8_t)*string++, 1);
         }
-        if (code_point < interval->first)
+        if (ascii == 0)
         {
-            return;
+            const char *next = string;
+            uint32_t cp = utf8_next(&next);
+            shape_code_point(run, cp, next - string);
+            string = next;
+        }
+    }
+    return string;
+}
+
+
+void text_run_update_bounds(TextRun *run)
+{
+    run->min_x = INT32_MAX;
+    run->min_y = INT32_MAX;
+    run->max_x = INT32_MIN;
+    run->max_y = INT32_MIN;
+    for (uint32_t i = 0; i < run->count; i++)
+    {
+        add_glyph_bounds(run, &run->glyphs[i]);
+    }
+}
+
+
+void text_run_bounds(const TextRun *run, int32_t x, int32_t y, Rect_t *bounds)
+{
+    if (run->min_x > run->max_x)
+    {
+        bounds->x = x;
+        bounds->y = y;
+        bounds->width = 0;
+        bounds->height = 0;
+        return;
+    }
+    bounds->x = x + run->min_x;
+    bounds->y = y + run->min_y;
+    bounds->width = run->max_x - run->min_x;
+    bounds->height = run->max_y - run->min_y;
+}
+
+
+void text_run_render(const TextRun *run, int32_t x, int32_t y,
+                     uint8_t *buffer, const Rect_t *buffer_area)
+{
+    int32_t buf_width = buffer_area->width / 2 + buffer_area->width % 2;
+    draw_run(run, buffer, x - buffer_area->x, y - buffer_area->y, buf_width,
+             buffer_area->height);
+}
+
+
+void text_run_draw(const TextRun *run, int32_t x, int32_t y,
+                   uint8_t *framebuffer, DrawMode_t mode)
+{
+    if (framebuffer != NULL)
+    {
+        Rect_t screen = epd_full_screen();
+        text_run_render(run, x, y, framebuffer, &screen);
+        return;
+    }
+
+    Rect_t area;
+    text_run_bounds(run, x, y, &area);
+    if (area.width <= 0 || area.height <= 0)
+    {
+        return;
+    }
+
+    uint32_t size = (area.width / 2 + area.width % 2) * area.height;
+    uint8_t *buffer = (uint8_t *)arena_scratch_alloc(size);
+    if (buffer == NULL)
+    {
+        ESP_LOGE("font.c", "cannot allocate text buffer!");
+        return;
+    }
+    memset(buffer, 255, size);
+    text_run_render(run, x, y, buffer, &area);
+    epd_draw_image(area, buffer, mode);
+    arena_scratch_free(buffer);
+}
+
+
+uint32_t text_run_hit_test(const TextRun *run, int32_t x, int32_t y)
+{
+    const GlyphPosition *glyphs = run->glyphs;
+
+    // find the line, a line extends down to the descender.
+    uint32_t line = 0;
+    for (uint32_t i = 1; i < run->count; i++)
+    {
+        if (glyphs[i].y != glyphs[line].y)
+        {
+            if (y < glyphs[line].y - run->font->descender)
+            {
+                break;
+            }
+            line = i;
         }
     }
-    return;
+
+    // the caret goes before the first glyph right of the position.
+    uint32_t i = line;
+    while (i < run->count && glyphs[i].y == glyphs[line].y &&
+           x >= glyphs[i].x + glyphs[i].glyph->advance_x / 2)
+    {
+        i++;
+    }
+    return i;
+}
+
+
+void release_font_cache(const GFXfont *font)
+{
+    for (int32_t i = 0; i < FONT_INDEX_MAX_FONTS; i++)
+    {
+        if (font_indices[i] != NULL && font_indices[i]->font == font)
+        {
+            free(font_indices[i]);
+            font_indices[i] = NULL;
+        }
+    }
+    if (font->compressed)
+    {
+        glyph_cache_clear();
+    }
+    text_cache_clear();
 }
 
 
@@ -132,17 +391,27 @@ void get_text_bounds(const GFXfont *font,
                      int32_t *h,
                      const FontProperties *properties)
 {
-    FontProperties props;
-    if (properties == NULL)
-    {
-        props = font_properties_default();
-    }
-    else
+    GlyphPosition glyphs[TEXT_RUN_CHUNK];
+    TextRun run;
+    int32_t min_x = INT32_MAX, min_y = INT32_MAX;
+    int32_t max_x = INT32_MIN, max_y = INT32_MIN;
+    int32_t pen_x = 0, pen_y = 0;
+
+    while (*string != '\0')
     {
-        props = *properties;
+        text_run_init(&run, font, glyphs, TEXT_RUN_CHUNK, properties);
+        run.pen_x = pen_x;
+        run.pen_y = pen_y;
+        string = text_run_shape(&run, string);
+        min_x = min(min_x, run.min_x);
+        min_y = min(min_y, run.min_y);
+        max_x = max(max_x, run.max_x);
+        max_y = max(max_y, run.max_y);
+        pen_x = run.pen_x;
+        pen_y = run.pen_y;
     }
 
-    if (*string == '\0')
+    if (min_x > max_x)
     {
         *w = 0;
         *h = 0;
@@ -150,19 +419,16 @@ void get_text_bounds(const GFXfont *font,
         *x1 = *x;
         return;
     }
-    int32_t minx = 100000, miny = 100000, maxx = -1, maxy = -1;
-    int32_t original_x = *x;
-    uint32_t c;
-    while ((c = next_cp((uint8_t **)&string)))
-    {
-        get_char_bounds(font, c, x, y, &minx, &miny, &maxx, &maxy, &props);
-    }
-    *x1 = min(original_x, minx);
-    *w = maxx - *x1;
-    *y1 = miny;
-    *h = maxy - miny;
+    // y1 is mirrored at the base line, the bottom of the text.
+    *x1 = min(*x, *x + min_x);
+    *w = *x + max_x - *x1;
+    *y1 = *y - max_y;
+    *h = max_y - min_y;
+    *x += pen_x;
+    *y += pen_y;
 }
 
+
 void write_mode(const GFXfont *font,
                 const char *string,
                 int32_t *cursor_x,
@@ -171,80 +437,51 @@ void write_mode(const GFXfont *font,
                 DrawMode_t mode,
                 const FontProperties *properties)
 {
-    if (*string == '\0') return ;
-
-    FontProperties props = (properties == NULL) ? font_properties_default() \
-                                                : *properties;
-
-    int32_t x1 = 0, y1 = 0, w = 0, h = 0;
-    int32_t tmp_cur_x = *cursor_x;
-    int32_t tmp_cur_y = *cursor_y;
-    get_text_bounds(font, string, &tmp_cur_x, &tmp_cur_y, &x1, &y1, &w, &h, &props);
-
-    uint8_t *buffer;
-    int32_t buf_width;
-    int32_t buf_height;
-    int32_t baseline_height = *cursor_y - y1;
-
-    // The local cursor position:
-    // 0, if drawing to a local temporary buffer
-    // the given cursor position, if drawing to a full frame buffer
-    int32_t local_cursor_x = 0;
-    int32_t local_cursor_y = 0;
-
-    if (framebuffer == NULL)
+    // changing text would only evict the labels from the cache.
+    if (properties != NULL && (properties->flags & DRAW_CACHED) &&
+        write_cached(font, string, cursor_x, cursor_y, framebuffer, mode,
+                     properties))
     {
-        buf_width = (w / 2 + w % 2);
-        buf_height = h;
-        buffer = (uint8_t *)malloc(buf_width * buf_height);
-        memset(buffer, 255, buf_width * buf_height);
-        local_cursor_y = buf_height - baseline_height;
+        return;
     }
-    else
+
+    // shape in chunks, so any length of text needs no heap for glyphs.
+    int32_t pen_x, pen_y;
+    if (framebuffer != NULL)
     {
-        buf_width = EPD_WIDTH / 2;
-        buf_height = EPD_HEIGHT;
-        buffer = framebuffer;
-        local_cursor_x = *cursor_x;
-        local_cursor_y = *cursor_y;
+        Rect_t screen = epd_full_screen();
+        shape_chunks(font, string, *cursor_x, *cursor_y, properties,
+                     framebuffer, &screen, NULL, &pen_x, &pen_y);
+        *cursor_x += pen_x;
+        *cursor_y += pen_y;
+        return;
     }
 
-    uint32_t c;
-
-    int32_t cursor_x_init = local_cursor_x;
-    int32_t cursor_y_init = local_cursor_y;
-
-    uint8_t bg = props.bg_color;
-    if (props.flags & DRAW_BACKGROUND)
+    // the chunks are shaped twice, once for the bounds and once into a
+    // single image, so the panel is updated once for the whole string.
+    Rect_t area = {.width = 0};
+    shape_chunks(font, string, *cursor_x, *cursor_y, properties, NULL, NULL,
+                 &area, &pen_x, &pen_y);
+    if (area.width > 0 && area.height > 0)
     {
-        for (int32_t l = 0; l < font->advance_y; l++)
+        uint32_t size = (area.width / 2 + area.width % 2) * area.height;
+        uint8_t *buffer = (uint8_t *)arena_scratch_alloc(size);
+        if (buffer == NULL)
         {
-            epd_draw_hline(local_cursor_x,
-                           local_cursor_y - (font->advance_y - baseline_height) + l,
-                           w,
-                           bg << 4,
-                           buffer);
+            ESP_LOGE("font.c", "cannot allocate text buffer!");
+        }
+        else
+        {
+            memset(buffer, 255, size);
+            shape_chunks(font, string, *cursor_x, *cursor_y, properties,
+                         buffer, &area, NULL, &pen_x, &pen_y);
+            epd_draw_image(area, buffer, mode);
+            arena_scratch_free(buffer);
         }
     }
-    while ((c = next_cp((uint8_t **)&string)))
-    {
-        draw_char(font, buffer, &local_cursor_x, local_cursor_y, buf_width, buf_height, c, &props);
-    }
-
-    *cursor_x += local_cursor_x - cursor_x_init;
-    *cursor_y += local_cursor_y - cursor_y_init;
 
-    if (framebuffer == NULL)
-    {
-        Rect_t area = {
-            .x = x1,
-            .y = *cursor_y - h + baseline_height,
-            .width = w,
-            .height = h
-        };
-        epd_draw_image(area, buffer, mode);
-        free(buffer);
-    }
+    *cursor_x += pen_x;
+    *cursor_y += pen_y;
 }
 
 
@@ -264,71 +501,88 @@ void write_string(const GFXfont *font,
                   int32_t *cursor_y,
                   uint8_t *framebuffer)
 {
-    char *token, *newstring, *tofree;
     if (string == NULL)
     {
         ESP_LOGE("font.c", "cannot draw a NULL string!");
         return;
     }
-    tofree = newstring = strdup(string);
-    if (newstring == NULL)
-    {
-        ESP_LOGE("font.c", "cannot allocate string copy!");
-        return;
-    }
-
-    // taken from the strsep manpage
-    int32_t line_start = *cursor_x;
-    while ((token = strsep(&newstring, "\n")) != NULL)
-    {
-        *cursor_x = line_start;
-        writeln(font, token, cursor_x, cursor_y, framebuffer);
-        *cursor_y += font->advance_y;
-    }
 
-    free(tofree);
+    // line feeds are handled by the text run.
+    writeln(font, string, cursor_x, cursor_y, framebuffer);
+    *cursor_y += font->advance_y;
 }
 
 /******************************************************************************/
 /***        local functions                                                 ***/
 /******************************************************************************/
 
-static int32_t utf8_len(const uint8_t ch)
+static font_index_t *font_index(const GFXfont *font)
 {
-    int32_t len = 0;
-    for (utf_t **u = utf; *u; ++u)
+    // released fonts leave gaps, an index may follow a free slot.
+    int32_t free_slot = -1;
+    for (int32_t i = 0; i < FONT_INDEX_MAX_FONTS; i++)
     {
-        if ((ch & ~(*u)->mask) == (*u)->lead)
+        font_index_t *index = font_indices[i];
+        if (index != NULL && index->font == font)
+        {
+            return index;
+        }
+        if (index == NULL && free_slot < 0)
         {
-            break;
+            free_slot = i;
         }
-        ++len;
     }
-    if (len > 4)
-    { /* Malformed leading byte */
-        assert("invalid unicode.");
+    if (free_slot < 0)
+    {
+        return NULL;
+    }
+
+    font_index_t *index = (font_index_t *)malloc(sizeof(font_index_t));
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    index->font = font;
+    for (uint32_t cp = 0; cp < FONT_INDEX_DIRECT_CPS; cp++)
+    {
+        GFXglyph *glyph = find_glyph(font, cp);
+        index->direct[cp] = glyph ? glyph - font->glyph + 1 : 0;
+    }
+    for (int32_t e = 0; e < FONT_INDEX_CACHE_SIZE; e++)
+    {
+        // code point 0 is served by the direct table, so it never
+        // matches a cache entry.
+        index->cache[e].cp = 0;
+        index->cache[e].glyph = NULL;
     }
-    return len;
+    font_indices[free_slot] = index;
+    return index;
 }
 
 
-static uint32_t next_cp(uint8_t **string)
+static GFXglyph *find_glyph(const GFXfont *font, uint32_t code_point)
 {
-    if (**string == 0) return 0;
-
-    int32_t bytes = utf8_len(**string);
-    uint8_t *chr = *string;
-    *string += bytes;
-    int32_t shift = utf[0]->bits_stored * (bytes - 1);
-    uint32_t codep = (*chr++ & utf[bytes]->mask) << shift;
-
-    for (int32_t i = 1; i < bytes; ++i, ++chr)
+    // intervals are sorted and do not overlap.
+    int32_t lo = 0;
+    int32_t hi = (int32_t)font->interval_count - 1;
+    while (lo <= hi)
     {
-        shift -= utf[0]->bits_stored;
-        codep |= ((uint8_t)*chr & utf[0]->mask) << shift;
+        int32_t mid = (lo + hi) / 2;
+        UnicodeInterval *interval = &font->intervals[mid];
+        if (code_point < interval->first)
+        {
+            hi = mid - 1;
+        }
+        else if (code_point > interval->last)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            return &font->glyph[interval->offset + (code_point - interval->first)];
+        }
     }
-
-    return codep;
+    return NULL;
 }
 
 
@@ -344,143 +598,378 @@ static FontProperties font_properties_default()
 }
 
 
-static void IRAM_ATTR draw_char(const GFXfont *font,
-                                uint8_t *buffer,
-                                int32_t *cursor_x,
-                                int32_t cursor_y,
-                                uint16_t buf_width,
-                                uint16_t buf_height,
-                                uint32_t cp,
-                                const FontProperties *props)
+static void shape_code_point(TextRun *run, uint32_t cp, uint32_t bytes)
 {
-    GFXglyph *glyph;
-    get_glyph(font, cp, &glyph);
+    const GFXfont *font = run->font;
+    uint32_t offset = run->bytes;
+    run->bytes += bytes;
 
-    if (!glyph)
+    if (cp == '\n')
     {
-        get_glyph(font, props->fallback_glyph, &glyph);
+        run->pen_x = 0;
+        run->pen_y += font->advance_y;
+        return;
     }
 
+    // malformed input is drawn as the fallback glyph.
+    GFXglyph *glyph = NULL;
+    if (cp != UTF8_INVALID)
+    {
+        get_glyph(font, cp, &glyph);
+    }
+    if (!glyph)
+    {
+        get_glyph(font, run->props.fallback_glyph, &glyph);
+    }
     if (!glyph)
     {
         return;
     }
 
-    uint32_t offset = glyph->data_offset;
-    uint8_t width = glyph->width;
-    uint8_t height = glyph->height;
-    int32_t left = glyph->left;
+    GlyphPosition *pos = &run->glyphs[run->count++];
+    pos->glyph = glyph;
+    pos->x = run->pen_x;
+    pos->y = run->pen_y;
+    pos->offset = offset;
+    add_glyph_bounds(run, pos);
 
-    int32_t byte_width = (width / 2 + width % 2);
-    unsigned long bitmap_size = byte_width * height;
-    uint8_t *bitmap = NULL;
-    if (font->compressed)
+    run->pen_x += glyph->advance_x;
+}
+
+
+static void add_glyph_bounds(TextRun *run, const GlyphPosition *pos)
+{
+    const GFXfont *font = run->font;
+    const GFXglyph *glyph = pos->glyph;
+
+    int32_t x1 = pos->x + glyph->left;
+    int32_t y1 = pos->y - glyph->top;
+    int32_t x2 = x1 + glyph->width;
+    int32_t y2 = y1 + glyph->height;
+    // background needs to be taken into account
+    if (run->props.flags & DRAW_BACKGROUND)
+    {
+        x1 = min(x1, pos->x);
+        x2 = max(x2, pos->x + glyph->advance_x);
+        y1 = min(y1, pos->y - font->descender - font->advance_y);
+        y2 = max(y2, pos->y - font->descender);
+    }
+    run->min_x = min(run->min_x, x1);
+    run->min_y = min(run->min_y, y1);
+    run->max_x = max(run->max_x, x2);
+    run->max_y = max(run->max_y, y2);
+}
+
+
+static void glyph_colors_init(glyph_colors_t *colors,
+                              const FontProperties *props)
+{
+    int32_t color_difference = (int32_t)props->fg_color - (int32_t)props->bg_color;
+    for (int32_t c = 0; c < 16; c++)
+    {
+        colors->color[c] = max(0, min(15, props->bg_color + c * color_difference / 15));
+    }
+    for (int32_t b = 0; b < 256; b++)
     {
-        bitmap = (uint8_t *)malloc(bitmap_size);
-        // uncompress(bitmap, &bitmap_size, &font->bitmap[offset], glyph->compressed_size);
+        colors->pair[b] = colors->color[b & 0xF] | (colors->color[b >> 4] << 4);
+    }
+    colors->inverted = props->fg_color == 0 && props->bg_color == 15;
+}
+
+
+static inline void set_nibble(uint8_t *row, int32_t x, uint8_t color)
+{
+    if (x & 1)
+    {
+        row[x / 2] = (row[x / 2] & 0x0F) | (color << 4);
     }
     else
     {
-        bitmap = &font->bitmap[offset];
+        row[x / 2] = (row[x / 2] & 0xF0) | color;
     }
+}
 
-    uint8_t color_lut[16];
-    for (int32_t c = 0; c < 16; c++)
+
+static void IRAM_ATTR blit_glyph_row(uint8_t *dst, int32_t dx,
+                                     const uint8_t *src, int32_t sx,
+                                     int32_t n, const glyph_colors_t *colors)
+{
+    // align the destination to a byte.
+    if (n > 0 && (dx & 1))
     {
-        int32_t color_difference = (int32_t)props->fg_color - (int32_t)props->bg_color;
-        color_lut[c] = max(0, min(15, props->bg_color + c * color_difference / 15));
+        uint8_t v = src[sx / 2];
+        set_nibble(dst, dx, colors->color[(sx & 1) ? v >> 4 : v & 0xF]);
+        dx++;
+        sx++;
+        n--;
     }
 
-    for (int32_t y = 0; y < height; y++)
+    uint8_t *d = dst + dx / 2;
+    const uint8_t *s = src + sx / 2;
+    int32_t pairs = n / 2;
+    if ((sx & 1) == 0)
     {
-        int32_t yy = cursor_y - glyph->top + y;
-        if (yy < 0 || yy >= buf_height)
+        // same nibble phase, one glyph byte is one buffer byte.
+        if (colors->inverted)
         {
-            continue;
-        }
-        int32_t start_pos = *cursor_x + left;
-        bool byte_complete = start_pos % 2;
-        int32_t x = max(0, -start_pos);
-        int32_t max_x = min(start_pos + width, buf_width * 2);
-        for (int32_t xx = start_pos; xx < max_x; xx++)
-        {
-            uint32_t buf_pos = yy * buf_width + xx / 2;
-            uint8_t old = buffer[buf_pos];
-            uint8_t bm = bitmap[y * byte_width + x / 2];
-            if ((x & 1) == 0)
+            for (int32_t i = 0; i < pairs; i++)
             {
-                bm = bm & 0xF;
+                d[i] = ~s[i];
             }
-            else
+        }
+        else
+        {
+            for (int32_t i = 0; i < pairs; i++)
             {
-                bm = bm >> 4;
+                d[i] = colors->pair[s[i]];
             }
+        }
+        if (n & 1)
+        {
+            d[pairs] = (d[pairs] & 0xF0) | colors->color[s[pairs] & 0xF];
+        }
+    }
+    else
+    {
+        // opposite phase, a buffer byte takes the upper nibble of one glyph
+        // byte and the lower nibble of the next.
+        for (int32_t i = 0; i < pairs; i++)
+        {
+            uint8_t v = (s[i] >> 4) | (s[i + 1] << 4);
+            d[i] = colors->inverted ? ~v : colors->pair[v];
+        }
+        if (n & 1)
+        {
+            d[pairs] = (d[pairs] & 0xF0) | colors->color[s[pairs] >> 4];
+        }
+    }
+}
 
-            if ((xx & 1) == 0)
-            {
-                buffer[buf_pos] = (old & 0xF0) | color_lut[bm];
-            }
-            else
-            {
-                buffer[buf_pos] = (old & 0x0F) | (color_lut[bm] << 4);
-            }
-            byte_complete = !byte_complete;
-            x++;
+
+static void fill_box(uint8_t *buffer, int32_t buf_width, int32_t buf_height,
+                     const Rect_t *box, uint8_t color)
+{
+    int32_t x0 = max(0, box->x);
+    int32_t x1 = min(buf_width * 2, box->x + box->width);
+    int32_t y0 = max(0, box->y);
+    int32_t y1 = min(buf_height, box->y + box->height);
+    for (int32_t y = y0; y < y1; y++)
+    {
+        uint8_t *row = &buffer[y * buf_width];
+        int32_t x = x0;
+        if (x < x1 && (x & 1))
+        {
+            set_nibble(row, x++, color);
+        }
+        int32_t bytes = (x1 - x) / 2;
+        memset(&row[x / 2], color | (color << 4), max(0, bytes));
+        x += 2 * max(0, bytes);
+        if (x < x1)
+        {
+            set_nibble(row, x, color);
         }
     }
-    if (font->compressed)
+}
+
+
+static bool write_cached(const GFXfont *font, const char *string,
+                         int32_t *cursor_x, int32_t *cursor_y,
+                         uint8_t *framebuffer, DrawMode_t mode,
+                         const FontProperties *properties)
+{
+    FontProperties props = *properties;
+    text_cache_key_t key;
+    if (!text_cache_key(&key, font, string, &props, *cursor_x))
+    {
+        return false;
+    }
+
+    const text_cache_entry_t *entry = text_cache_lookup(&key);
+    if (entry == NULL)
+    {
+        // a string never has more glyphs than bytes.
+        GlyphPosition *glyphs =
+            (GlyphPosition *)arena_scratch_alloc(key.length *
+                                                 sizeof(GlyphPosition));
+        if (glyphs == NULL)
+        {
+            return false;
+        }
+        TextRun run;
+        text_run_init(&run, font, glyphs, key.length, &props);
+        text_run_shape(&run, string);
+
+        Rect_t area;
+        text_run_bounds(&run, 0, 0, &area);
+        // start the image on a framebuffer byte, so hits copy whole bytes.
+        if ((*cursor_x + area.x) & 1)
+        {
+            area.x--;
+            area.width++;
+        }
+        text_cache_entry_t *added = NULL;
+        if (area.width > 0 && area.height > 0)
+        {
+            added = text_cache_insert(&key, area);
+        }
+        if (added == NULL)
+        {
+            arena_scratch_free(glyphs);
+            return false;
+        }
+
+        text_run_render(&run, 0, 0, added->image, &area);
+        if (props.flags & DRAW_BACKGROUND)
+        {
+            Rect_t box;
+            text_run_bounds(&run, 0, 0, &box);
+            text_cache_mark(added, box.x - area.x, 0, box.width, box.height);
+        }
+        for (uint32_t i = 0; i < run.count; i++)
+        {
+            const GlyphPosition *pos = &run.glyphs[i];
+            text_cache_mark(added, pos->x + pos->glyph->left - area.x,
+                            pos->y - pos->glyph->top - area.y,
+                            pos->glyph->width, pos->glyph->height);
+        }
+        added->pen_x = run.pen_x;
+        added->pen_y = run.pen_y;
+        arena_scratch_free(glyphs);
+        entry = added;
+    }
+
+    if (framebuffer != NULL)
+    {
+        text_cache_blit(entry, *cursor_x, *cursor_y, framebuffer);
+    }
+    else
     {
-        free(bitmap);
+        Rect_t area = entry->area;
+        area.x += *cursor_x;
+        area.y += *cursor_y;
+        epd_draw_image(area, entry->image, mode);
     }
-    *cursor_x += glyph->advance_x;
+    *cursor_x += entry->pen_x;
+    *cursor_y += entry->pen_y;
+    return true;
 }
 
 
-static void get_char_bounds(const GFXfont *font,
-                            uint32_t cp,
-                            int32_t *x,
-                            int32_t *y,
-                            int32_t *minx,
-                            int32_t *miny,
-                            int32_t *maxx,
-                            int32_t *maxy,
-                            const FontProperties *props)
+static void shape_chunks(const GFXfont *font, const char *string, int32_t x,
+                         int32_t y, const FontProperties *properties,
+                         uint8_t *buffer, const Rect_t *buffer_area,
+                         Rect_t *bounds, int32_t *pen_x, int32_t *pen_y)
 {
-    GFXglyph *glyph;
-    get_glyph(font, cp, &glyph);
+    GlyphPosition glyphs[TEXT_RUN_CHUNK];
+    TextRun run;
+    *pen_x = 0;
+    *pen_y = 0;
 
-    if (!glyph)
+    while (*string != '\0')
     {
-        get_glyph(font, props->fallback_glyph, &glyph);
+        text_run_init(&run, font, glyphs, TEXT_RUN_CHUNK, properties);
+        run.pen_x = *pen_x;
+        run.pen_y = *pen_y;
+        string = text_run_shape(&run, string);
+        *pen_x = run.pen_x;
+        *pen_y = run.pen_y;
+
+        if (buffer != NULL)
+        {
+            text_run_render(&run, x, y, buffer, buffer_area);
+        }
+        if (bounds == NULL)
+        {
+            continue;
+        }
+
+        Rect_t chunk;
+        text_run_bounds(&run, x, y, &chunk);
+        int32_t x1 = max(chunk.x, 0);
+        int32_t y1 = max(chunk.y, 0);
+        int32_t x2 = min(chunk.x + chunk.width, EPD_WIDTH);
+        int32_t y2 = min(chunk.y + chunk.height, EPD_HEIGHT);
+        if (chunk.width <= 0 || chunk.height <= 0 || x1 >= x2 || y1 >= y2)
+        {
+            continue;
+        }
+        if (bounds->width > 0)
+        {
+            x1 = min(x1, bounds->x);
+            y1 = min(y1, bounds->y);
+            x2 = max(x2, bounds->x + bounds->width);
+            y2 = max(y2, bounds->y + bounds->height);
+        }
+        bounds->x = x1;
+        bounds->y = y1;
+        bounds->width = x2 - x1;
+        bounds->height = y2 - y1;
     }
+}
 
-    if (!glyph) return ;
 
-    int32_t x1 = *x + glyph->left;
-    int32_t y1 = *y + (glyph->top - glyph->height);
-    int32_t x2 = x1 + glyph->width;
-    int32_t y2 = y1 + glyph->height;
+static void IRAM_ATTR draw_run(const TextRun *run, uint8_t *buffer,
+                               int32_t x, int32_t y,
+                               int32_t buf_width, int32_t buf_height)
+{
+    if (run->props.flags & DRAW_BACKGROUND)
+    {
+        Rect_t box;
+        text_run_bounds(run, x, y, &box);
+        fill_box(buffer, buf_width, buf_height, &box, run->props.bg_color);
+    }
 
-    // background needs to be taken into account
-    if (props->flags & DRAW_BACKGROUND)
+    glyph_colors_t colors;
+    glyph_colors_init(&colors, &run->props);
+    for (uint32_t i = 0; i < run->count; i++)
     {
-        *minx = min(*x, min(*minx, x1));
-        *maxx = max(max(*x + glyph->advance_x, x2), *maxx);
-        *miny = min(*y + font->descender, min(*miny, y1));
-        *maxy = max(font->descender + font->advance_y, max(*maxy, y2));
+        const GlyphPosition *pos = &run->glyphs[i];
+        draw_glyph(run->font, pos->glyph, buffer, x + pos->x, y + pos->y,
+                   buf_width, buf_height, &colors);
+    }
+}
+
+
+static void IRAM_ATTR draw_glyph(const GFXfont *font,
+                                 const GFXglyph *glyph,
+                                 uint8_t *buffer,
+                                 int32_t pen_x,
+                                 int32_t pen_y,
+                                 int32_t buf_width,
+                                 int32_t buf_height,
+                                 const glyph_colors_t *colors)
+{
+    uint8_t width = glyph->width;
+    uint8_t height = glyph->height;
+    int32_t byte_width = (width / 2 + width % 2);
+
+    const uint8_t *bitmap = NULL;
+    if (font->compressed)
+    {
+        bitmap = glyph_cache_get(font, glyph);
+        if (bitmap == NULL)
+        {
+            return;
+        }
     }
     else
     {
-        if (x1 < *minx)
-            *minx = x1;
-        if (y1 < *miny)
-            *miny = y1;
-        if (x2 > *maxx)
-            *maxx = x2;
-        if (y2 > *maxy)
-            *maxy = y2;
+        bitmap = &font->bitmap[glyph->data_offset];
+    }
+
+    // clip the glyph box to the buffer once.
+    int32_t start_pos = pen_x + glyph->left;
+    int32_t x0 = max(0, -start_pos);
+    int32_t x1 = min(width, buf_width * 2 - start_pos);
+    int32_t top = pen_y - glyph->top;
+    int32_t y0 = max(0, -top);
+    int32_t y1 = min(height, buf_height - top);
+
+    for (int32_t y = y0; y < y1 && x0 < x1; y++)
+    {
+        blit_glyph_row(&buffer[(top + y) * buf_width], start_pos + x0,
+                       &bitmap[y * byte_width], x0, x1 - x0, colors);
     }
-    *x += glyph->advance_x;
 }
 
 /******************************************************************************/
@@ -0,0 +1,303 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "font_pack.h"
+
+#include <esp_log.h>
+#include <esp_partition.h>
+
+#include <stddef.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    /// View of the font data in the mapped pack.
+    GFXfont font;
+    const font_pack_entry_t *entry;
+    int32_t pack;
+} registered_font_t;
+
+typedef struct
+{
+    bool mounted;
+    esp_partition_mmap_handle_t handle;
+} mounted_pack_t;
+
+// the tables are used in place, so the C layouts are part of the format.
+_Static_assert(sizeof(font_pack_header_t) == 16, "font pack header layout");
+_Static_assert(sizeof(font_pack_entry_t) == 60, "font pack entry layout");
+_Static_assert(sizeof(UnicodeInterval) == 12, "interval layout");
+_Static_assert(sizeof(GFXglyph) == 16, "glyph layout");
+_Static_assert(offsetof(GFXglyph, left) == 4, "glyph layout");
+_Static_assert(offsetof(GFXglyph, data_offset) == 12, "glyph layout");
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Returns true if a table lies within the pack and is aligned.
+ */
+static bool table_valid(uint32_t pack_size, uint32_t offset, uint32_t count,
+                        uint32_t item_size);
+
+/**
+ * @brief Check the tables of a font entry.
+ */
+static bool entry_valid(const uint8_t *pack, uint32_t pack_size,
+                        const font_pack_entry_t *entry);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "font_pack";
+
+static registered_font_t fonts[FONT_PACK_MAX_FONTS];
+static uint32_t font_count = 0;
+
+static mounted_pack_t packs[FONT_PACK_MAX_PACKS];
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+esp_err_t font_pack_mount(const char *label)
+{
+    int32_t slot = -1;
+    for (int32_t i = 0; i < FONT_PACK_MAX_PACKS; i++)
+    {
+        if (!packs[i].mounted)
+        {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_partition_t *partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (partition == NULL)
+    {
+        ESP_LOGE(TAG, "no partition \"%s\"", label);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const void *mapped;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t err = esp_partition_mmap(partition, 0, partition->size,
+                                       ESP_PARTITION_MMAP_DATA, &mapped, &handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "cannot map \"%s\": %s", label, esp_err_to_name(err));
+        return err;
+    }
+
+    const uint8_t *pack = (const uint8_t *)mapped;
+    const font_pack_header_t *header = (const font_pack_header_t *)pack;
+    if (header->magic != FONT_PACK_MAGIC)
+    {
+        ESP_LOGE(TAG, "\"%s\" holds no font pack", label);
+        err = ESP_ERR_INVALID_RESPONSE;
+        goto fail;
+    }
+    if (header->version != FONT_PACK_VERSION)
+    {
+        ESP_LOGE(TAG, "\"%s\" has pack version %d, expected %d", label,
+                 header->version, FONT_PACK_VERSION);
+        err = ESP_ERR_INVALID_VERSION;
+        goto fail;
+    }
+    if (header->size > partition->size ||
+        !table_valid(header->size, sizeof(font_pack_header_t),
+                     header->font_count, sizeof(font_pack_entry_t)))
+    {
+        ESP_LOGE(TAG, "\"%s\" is truncated", label);
+        err = ESP_ERR_INVALID_RESPONSE;
+        goto fail;
+    }
+    if (font_count + header->font_count > FONT_PACK_MAX_FONTS)
+    {
+        ESP_LOGE(TAG, "too many fonts, raise FONT_PACK_MAX_FONTS");
+        err = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    const font_pack_entry_t *entries =
+        (const font_pack_entry_t *)(pack + sizeof(font_pack_header_t));
+    for (uint32_t i = 0; i < header->font_count; i++)
+    {
+        if (!entry_valid(pack, header->size, &entries[i]))
+        {
+            ESP_LOGE(TAG, "\"%s\": font %d is corrupt", label, (int)i);
+            err = ESP_ERR_INVALID_RESPONSE;
+            goto fail;
+        }
+    }
+
+    // the fonts are views of the mapped pack, nothing is copied.
+    for (uint32_t i = 0; i < header->font_count; i++)
+    {
+        const font_pack_entry_t *entry = &entries[i];
+        registered_font_t *registered = &fonts[font_count++];
+        registered->entry = entry;
+        registered->pack = slot;
+        registered->font.bitmap = (uint8_t *)(pack + entry->bitmap_offset);
+        registered->font.glyph = (GFXglyph *)(pack + entry->glyph_offset);
+        registered->font.intervals =
+            (UnicodeInterval *)(pack + entry->interval_offset);
+        registered->font.interval_count = entry->interval_count;
+        registered->font.compressed = entry->compressed;
+        registered->font.advance_y = entry->advance_y;
+        registered->font.ascender = entry->ascender;
+        registered->font.descender = entry->descender;
+        ESP_LOGI(TAG, "registered %s %d (%d glyphs)", entry->name,
+                 entry->size, (int)entry->glyph_count);
+    }
+
+    packs[slot].mounted = true;
+    packs[slot].handle = handle;
+    return ESP_OK;
+
+fail:
+    esp_partition_munmap(handle);
+    return err;
+}
+
+
+void font_pack_unmount_all()
+{
+    for (uint32_t i = 0; i < font_count; i++)
+    {
+        release_font_cache(&fonts[i].font);
+    }
+    font_count = 0;
+
+    for (int32_t i = 0; i < FONT_PACK_MAX_PACKS; i++)
+    {
+        if (packs[i].mounted)
+        {
+            esp_partition_munmap(packs[i].handle);
+            packs[i].mounted = false;
+        }
+    }
+}
+
+
+const GFXfont *font_pack_get(const char *name, uint16_t size)
+{
+    for (uint32_t i = 0; i < font_count; i++)
+    {
+        const font_pack_entry_t *entry = fonts[i].entry;
+        if (strncmp(entry->name, name, FONT_PACK_NAME_LEN) == 0 &&
+            (size == 0 || entry->size == size))
+        {
+            return &fonts[i].font;
+        }
+    }
+    return NULL;
+}
+
+
+uint32_t font_pack_count()
+{
+    return font_count;
+}
+
+
+const GFXfont *font_pack_get_index(uint32_t index, const char **name,
+                                   uint16_t *size)
+{
+    if (index >= font_count)
+    {
+        return NULL;
+    }
+    if (name != NULL)
+    {
+        *name = fonts[index].entry->name;
+    }
+    if (size != NULL)
+    {
+        *size = fonts[index].entry->size;
+    }
+    return &fonts[index].font;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static bool table_valid(uint32_t pack_size, uint32_t offset, uint32_t count,
+                        uint32_t item_size)
+{
+    if (offset % 4 != 0 || offset > pack_size)
+    {
+        return false;
+    }
+    return count <= (pack_size - offset) / item_size;
+}
+
+
+static bool entry_valid(const uint8_t *pack, uint32_t pack_size,
+                        const font_pack_entry_t *entry)
+{
+    if (memchr(entry->name, '\0', FONT_PACK_NAME_LEN) == NULL ||
+        !table_valid(pack_size, entry->interval_offset, entry->interval_count,
+                     sizeof(UnicodeInterval)) ||
+        !table_valid(pack_size, entry->glyph_offset, entry->glyph_count,
+                     sizeof(GFXglyph)) ||
+        !table_valid(pack_size, entry->bitmap_offset, entry->bitmap_size, 1))
+    {
+        return false;
+    }
+
+    // glyph lookup relies on sorted intervals pointing into the glyph table.
+    const UnicodeInterval *intervals =
+        (const UnicodeInterval *)(pack + entry->interval_offset);
+    for (uint32_t i = 0; i < entry->interval_count; i++)
+    {
+        const UnicodeInterval *interval = &intervals[i];
+        if (interval->last < interval->first ||
+            (i > 0 && interval->first <= intervals[i - 1].last) ||
+            interval->offset > entry->glyph_count ||
+            interval->last - interval->first >= entry->glyph_count - interval->offset)
+        {
+            return false;
+        }
+    }
+
+    const GFXglyph *glyphs = (const GFXglyph *)(pack + entry->glyph_offset);
+    for (uint32_t i = 0; i < entry->glyph_count; i++)
+    {
+        const GFXglyph *glyph = &glyphs[i];
+        uint32_t size = entry->compressed
+                            ? glyph->compressed_size
+                            : (glyph->width / 2 + glyph->width % 2) * glyph->height;
+        if (glyph->data_offset > entry->bitmap_size ||
+            size > entry->bitmap_size - glyph->data_offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,281 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "glyph_cache.h"
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <rom/miniz.h>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define NONE -1
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    const GFXfont *font;
+    /// Index of the glyph in the glyph array of the font.
+    uint32_t glyph;
+    uint8_t *bitmap;
+    uint32_t size;
+    /// Neighbours in the LRU list, most recently used first.
+    int16_t prev;
+    int16_t next;
+    /// Next entry in the same hash bucket, or in the free list.
+    int16_t chain;
+} cache_entry_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static uint32_t bucket_of(const GFXfont *font, uint32_t glyph);
+
+static void lru_unlink(int16_t e);
+
+static void lru_push_front(int16_t e);
+
+/**
+ * @brief Drop the least recently used entry.
+ */
+static void evict_one();
+
+/**
+ * @brief Inflate a glyph bitmap into `out`.
+ */
+static bool decompress(const GFXfont *font, const GFXglyph *glyph,
+                       uint8_t *out, uint32_t size);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "glyph_cache";
+
+static cache_entry_t entries[GLYPH_CACHE_ENTRIES];
+static int16_t buckets[GLYPH_CACHE_ENTRIES];
+static int16_t free_list = NONE;
+static int16_t lru_head = NONE;
+static int16_t lru_tail = NONE;
+static bool initialized = false;
+
+/**
+ * @brief Decompressor state, too large for the stack.
+ */
+static tinfl_decompressor *decompressor = NULL;
+
+static glyph_cache_stats_t stats;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+const uint8_t *glyph_cache_get(const GFXfont *font, const GFXglyph *glyph)
+{
+    static uint8_t empty[1];
+
+    if (!initialized)
+    {
+        glyph_cache_clear();
+    }
+
+    uint32_t size = (glyph->width / 2 + glyph->width % 2) * glyph->height;
+    if (size == 0)
+    {
+        return empty;
+    }
+
+    uint32_t index = glyph - font->glyph;
+    uint32_t bucket = bucket_of(font, index);
+    for (int16_t e = buckets[bucket]; e != NONE; e = entries[e].chain)
+    {
+        if (entries[e].font == font && entries[e].glyph == index)
+        {
+            lru_unlink(e);
+            lru_push_front(e);
+            stats.hits++;
+            return entries[e].bitmap;
+        }
+    }
+
+    stats.misses++;
+    while (free_list == NONE ||
+           (lru_tail != NONE && stats.bytes + size > GLYPH_CACHE_BYTES))
+    {
+        evict_one();
+    }
+
+    // glyph bitmaps go to external memory if there is some.
+    uint8_t *bitmap = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (bitmap == NULL)
+    {
+        bitmap = (uint8_t *)malloc(size);
+    }
+    if (bitmap == NULL)
+    {
+        ESP_LOGE(TAG, "cannot allocate %" PRIu32 " bytes for a glyph", size);
+        return NULL;
+    }
+    if (!decompress(font, glyph, bitmap, size))
+    {
+        stats.errors++;
+        free(bitmap);
+        return NULL;
+    }
+
+    int16_t e = free_list;
+    free_list = entries[e].chain;
+    entries[e].font = font;
+    entries[e].glyph = index;
+    entries[e].bitmap = bitmap;
+    entries[e].size = size;
+    entries[e].chain = buckets[bucket];
+    buckets[bucket] = e;
+    lru_push_front(e);
+    stats.bytes += size;
+    return bitmap;
+}
+
+
+void glyph_cache_clear()
+{
+    for (int16_t e = 0; e < GLYPH_CACHE_ENTRIES; e++)
+    {
+        if (initialized && entries[e].bitmap != NULL)
+        {
+            free(entries[e].bitmap);
+        }
+        entries[e].bitmap = NULL;
+        entries[e].chain = e + 1 < GLYPH_CACHE_ENTRIES ? e + 1 : NONE;
+        buckets[e] = NONE;
+    }
+    free_list = 0;
+    lru_head = NONE;
+    lru_tail = NONE;
+    stats.bytes = 0;
+    initialized = true;
+}
+
+
+void glyph_cache_get_stats(glyph_cache_stats_t *out)
+{
+    *out = stats;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static uint32_t bucket_of(const GFXfont *font, uint32_t glyph)
+{
+    return (((uint32_t)font >> 2) ^ (glyph * 2654435761u)) % GLYPH_CACHE_ENTRIES;
+}
+
+
+static void lru_unlink(int16_t e)
+{
+    cache_entry_t *entry = &entries[e];
+    if (entry->prev != NONE)
+    {
+        entries[entry->prev].next = entry->next;
+    }
+    else
+    {
+        lru_head = entry->next;
+    }
+    if (entry->next != NONE)
+    {
+        entries[entry->next].prev = entry->prev;
+    }
+    else
+    {
+        lru_tail = entry->prev;
+    }
+}
+
+
+static void lru_push_front(int16_t e)
+{
+    entries[e].prev = NONE;
+    entries[e].next = lru_head;
+    if (lru_head != NONE)
+    {
+        entries[lru_head].prev = e;
+    }
+    lru_head = e;
+    if (lru_tail == NONE)
+    {
+        lru_tail = e;
+    }
+}
+
+
+static void evict_one()
+{
+    int16_t e = lru_tail;
+    cache_entry_t *entry = &entries[e];
+    lru_unlink(e);
+
+    int16_t *link = &buckets[bucket_of(entry->font, entry->glyph)];
+    while (*link != e)
+    {
+        link = &entries[*link].chain;
+    }
+    *link = entry->chain;
+
+    free(entry->bitmap);
+    entry->bitmap = NULL;
+    stats.bytes -= entry->size;
+    stats.evictions++;
+
+    entry->chain = free_list;
+    free_list = e;
+}
+
+
+static bool decompress(const GFXfont *font, const GFXglyph *glyph,
+                       uint8_t *out, uint32_t size)
+{
+    if (decompressor == NULL)
+    {
+        decompressor = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+        if (decompressor == NULL)
+        {
+            ESP_LOGE(TAG, "cannot allocate the decompressor");
+            return false;
+        }
+    }
+
+    tinfl_init(decompressor);
+    size_t in_size = glyph->compressed_size;
+    size_t out_size = size;
+    tinfl_status status = tinfl_decompress(
+        decompressor, &font->bitmap[glyph->data_offset], &in_size, out, out,
+        &out_size,
+        TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    if (status != TINFL_STATUS_DONE || out_size != size)
+    {
+        ESP_LOGE(TAG, "corrupt glyph data at offset %" PRIu32, glyph->data_offset);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
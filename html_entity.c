@@ -0,0 +1,353 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "html_entity.h"
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Longest name of a known reference.
+ */
+#define NAME_MAX_LENGTH 6
+
+/**
+ * @brief Decoded for invalid numeric references.
+ */
+#define REPLACEMENT_CHARACTER 0xFFFD
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A named reference.
+ */
+typedef struct
+{
+    const char *name;
+    uint32_t code_point;
+} named_entity_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Decode a numeric reference, the text starts with `&#`.
+ */
+static size_t parse_numeric(const char *text, size_t length,
+                            uint32_t *code_point);
+
+/**
+ * @brief Look up a name, NULL if unknown.
+ */
+static const named_entity_t *find_named(const char *name, size_t length);
+
+/**
+ * @brief Value of a digit, -1 if not one.
+ */
+static int32_t digit_value(char c, bool hex);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/// Sorted by name in byte order, for binary search.
+static const named_entity_t named_entities[] = {
+    {"Aacute", 0x00C1},
+    {"Auml", 0x00C4},
+    {"Ccaron", 0x010C},
+    {"Dcaron", 0x010E},
+    {"Eacute", 0x00C9},
+    {"Ecaron", 0x011A},
+    {"Iacute", 0x00CD},
+    {"Lacute", 0x0139},
+    {"Lcaron", 0x013D},
+    {"Ncaron", 0x0147},
+    {"Oacute", 0x00D3},
+    {"Ocirc", 0x00D4},
+    {"Ouml", 0x00D6},
+    {"Racute", 0x0154},
+    {"Rcaron", 0x0158},
+    {"Scaron", 0x0160},
+    {"Tcaron", 0x0164},
+    {"Uacute", 0x00DA},
+    {"Uring", 0x016E},
+    {"Uuml", 0x00DC},
+    {"Yacute", 0x00DD},
+    {"Zcaron", 0x017D},
+    {"aacute", 0x00E1},
+    {"amp", 0x0026},
+    {"apos", 0x0027},
+    {"auml", 0x00E4},
+    {"bdquo", 0x201E},
+    {"bull", 0x2022},
+    {"ccaron", 0x010D},
+    {"copy", 0x00A9},
+    {"dcaron", 0x010F},
+    {"deg", 0x00B0},
+    {"divide", 0x00F7},
+    {"eacute", 0x00E9},
+    {"ecaron", 0x011B},
+    {"emsp", 0x2003},
+    {"ensp", 0x2002},
+    {"euro", 0x20AC},
+    {"frac12", 0x00BD},
+    {"frac14", 0x00BC},
+    {"frac34", 0x00BE},
+    {"gt", 0x003E},
+    {"hellip", 0x2026},
+    {"iacute", 0x00ED},
+    {"lacute", 0x013A},
+    {"laquo", 0x00AB},
+    {"larr", 0x2190},
+    {"lcaron", 0x013E},
+    {"ldquo", 0x201C},
+    {"lsquo", 0x2018},
+    {"lt", 0x003C},
+    {"mdash", 0x2014},
+    {"micro", 0x00B5},
+    {"middot", 0x00B7},
+    {"minus", 0x2212},
+    {"nbsp", 0x00A0},
+    {"ncaron", 0x0148},
+    {"ndash", 0x2013},
+    {"oacute", 0x00F3},
+    {"ocirc", 0x00F4},
+    {"ouml", 0x00F6},
+    {"para", 0x00B6},
+    {"plusmn", 0x00B1},
+    {"quot", 0x0022},
+    {"racute", 0x0155},
+    {"raquo", 0x00BB},
+    {"rarr", 0x2192},
+    {"rcaron", 0x0159},
+    {"rdquo", 0x201D},
+    {"reg", 0x00AE},
+    {"rsquo", 0x2019},
+    {"sbquo", 0x201A},
+    {"scaron", 0x0161},
+    {"sect", 0x00A7},
+    {"shy", 0x00AD},
+    {"sup2", 0x00B2},
+    {"sup3", 0x00B3},
+    {"szlig", 0x00DF},
+    {"tcaron", 0x0165},
+    {"thinsp", 0x2009},
+    {"times", 0x00D7},
+    {"trade", 0x2122},
+    {"uacute", 0x00FA},
+    {"uring", 0x016F},
+    {"uuml", 0x00FC},
+    {"yacute", 0x00FD},
+    {"zcaron", 0x017E},
+};
+
+/// Windows-1252 characters of the C1 controls U+0080 to U+009F, 0 for the
+/// controls that stay as they are.
+static const uint16_t c1_code_points[32] = {
+    0x20AC, 0,      0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0,      0x017D, 0,
+    0,      0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0,      0x017E, 0x0178,
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+size_t html_entity_parse(const char *text, size_t length,
+                         uint32_t *code_point)
+{
+    if (length < 4 || text[0] != '&')
+    {
+        return 0;
+    }
+    if (length > HTML_ENTITY_MAX_LENGTH)
+    {
+        length = HTML_ENTITY_MAX_LENGTH;
+    }
+    if (text[1] == '#')
+    {
+        return parse_numeric(text, length, code_point);
+    }
+
+    size_t end = 1;
+    while (end < length && end <= NAME_MAX_LENGTH + 1 && text[end] != ';')
+    {
+        end++;
+    }
+    if (end == length || text[end] != ';')
+    {
+        return 0;
+    }
+    const named_entity_t *entity = find_named(&text[1], end - 1);
+    if (entity == NULL)
+    {
+        return 0;
+    }
+    *code_point = entity->code_point;
+    return end + 1;
+}
+
+
+size_t html_entity_decode(char *text, size_t length, uint32_t flags)
+{
+    // the output never overtakes the input, see html_entity_to_utf8().
+    size_t consumed;
+    return html_entity_to_utf8(text, length, &consumed, text, length, NULL,
+                               flags);
+}
+
+
+size_t html_entity_to_utf8(const char *in, size_t in_length, size_t *consumed,
+                           char *out, size_t out_capacity,
+                           html_entity_charset_t charset, uint32_t flags)
+{
+    const uint8_t *src = (const uint8_t *)in;
+    size_t i = 0;
+    size_t n = 0;
+
+    while (i < in_length)
+    {
+        uint32_t code_point;
+        size_t used = src[i] == '&'
+                          ? html_entity_parse(&in[i], in_length - i, &code_point)
+                          : 0;
+        if (used == 0 && (src[i] < 0x80 || charset == NULL))
+        {
+            // the common case, a byte that stays as it is.
+            if (n == out_capacity)
+            {
+                break;
+            }
+            out[n++] = in[i++];
+            continue;
+        }
+        if (used == 0)
+        {
+            code_point = charset(src[i]);
+            used = 1;
+        }
+        else if (code_point == 0xA0 && (flags & HTML_ENTITY_NBSP_SPACE))
+        {
+            code_point = ' ';
+        }
+
+        // a reference is never shorter than its encoding, in place works.
+        char utf8[UTF8_MAX_LENGTH];
+        uint32_t bytes = utf8_encode(code_point, utf8);
+        if (out_capacity - n < bytes)
+        {
+            break;
+        }
+        memcpy(&out[n], utf8, bytes);
+        n += bytes;
+        i += used;
+    }
+
+    *consumed = i;
+    return n;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static size_t parse_numeric(const char *text, size_t length,
+                            uint32_t *code_point)
+{
+    bool hex = text[2] == 'x' || text[2] == 'X';
+    size_t start = hex ? 3 : 2;
+    size_t i = start;
+    uint32_t value = 0;
+    int32_t digit;
+
+    while (i < length && (digit = digit_value(text[i], hex)) >= 0)
+    {
+        // the length limit keeps the value far from overflowing.
+        value = value * (hex ? 16 : 10) + digit;
+        i++;
+    }
+    if (i == start || i == length || text[i] != ';')
+    {
+        return 0;
+    }
+
+    if (value >= 0x80 && value < 0xA0 && c1_code_points[value - 0x80] != 0)
+    {
+        value = c1_code_points[value - 0x80];
+    }
+    else if (value == 0 || value > 0x10FFFF ||
+             (value >= 0xD800 && value <= 0xDFFF))
+    {
+        value = REPLACEMENT_CHARACTER;
+    }
+    *code_point = value;
+    return i + 1;
+}
+
+
+static const named_entity_t *find_named(const char *name, size_t length)
+{
+    size_t low = 0;
+    size_t high = sizeof(named_entities) / sizeof(named_entities[0]);
+
+    while (low < high)
+    {
+        size_t mid = (low + high) / 2;
+        const char *candidate = named_entities[mid].name;
+        int order = strncmp(name, candidate, length);
+        if (order == 0)
+        {
+            // the name is a prefix of the candidate, it sorts before it.
+            order = candidate[length] == '\0' ? 0 : -1;
+        }
+        if (order == 0)
+        {
+            return &named_entities[mid];
+        }
+        if (order < 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+
+static int32_t digit_value(char c, bool hex)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (hex && c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    if (hex && c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -22,8 +22,6 @@
 /***        macro definitions                                               ***/
 /******************************************************************************/
 
-#define USER_I2S_REG 0
-
 /******************************************************************************/
 /***        type definitions                                                ***/
 /******************************************************************************/
@@ -213,10 +211,10 @@ static bool notify_trans_done(esp_lcd_panel_io_handle_t panel_io, esp_lcd_panel_
 #if USER_I2S_REG
 void i2s_bus_init(i2s_bus_config *cfg)
 {
-    // TODO: Why?
-    gpio_num_t I2S_GPIO_BUS[] = {cfg->data_6, cfg->data_7, cfg->data_4,
-                                 cfg->data_5, cfg->data_2, cfg->data_3,
-                                 cfg->data_0, cfg->data_1};
+    // Line buffers are kept in wire order, so the pins are routed in order.
+    gpio_num_t I2S_GPIO_BUS[] = {cfg->data_0, cfg->data_1, cfg->data_2,
+                                 cfg->data_3, cfg->data_4, cfg->data_5,
+                                 cfg->data_6, cfg->data_7};
 
     gpio_set_direction(cfg->start_pulse, GPIO_MODE_OUTPUT);
     gpio_set_level(cfg->start_pulse, 1);
@@ -354,11 +352,6 @@ void i2s_bus_init(i2s_bus_config *cfg)
 #else
 void i2s_bus_init(i2s_bus_config *cfg)
 {
-    // TODO: Why?
-    // gpio_num_t I2S_GPIO_BUS[] = {cfg->data_6, cfg->data_7, cfg->data_4,
-    //                              cfg->data_5, cfg->data_2, cfg->data_3,
-    //                              cfg->data_0, cfg->data_1};
-
     // gpio_set_direction(cfg->start_pulse, GPIO_MODE_OUTPUT);
     // gpio_set_level(cfg->start_pulse, 1);
     // // store pin in global variable for use in interrupt.
@@ -370,15 +363,16 @@ void i2s_bus_init(i2s_bus_config *cfg)
         .clk_src = LCD_CLK_SRC_DEFAULT,
         .dc_gpio_num = cfg->start_pulse,
         .wr_gpio_num = cfg->clock,
+        // line buffers are kept in wire order, so the pins are routed in order.
         .data_gpio_nums = {
-            cfg->data_6,
-            cfg->data_7,
-            cfg->data_4,
-            cfg->data_5,
-            cfg->data_2,
-            cfg->data_3,
             cfg->data_0,
             cfg->data_1,
+            cfg->data_2,
+            cfg->data_3,
+            cfg->data_4,
+            cfg->data_5,
+            cfg->data_6,
+            cfg->data_7,
         },
         .bus_width = 8,
         .max_transfer_bytes = (cfg->epd_row_width + 32)/4
@@ -0,0 +1,132 @@
+/**
+ * Bump allocator for memory that lives for one update cycle.
+ *
+ * An arena is one block taken from the heap once. Allocations move a pointer
+ * forward, the newest one can be given back in place, and a reset frees all
+ * of them at once. Memory that only lives until the update is on the panel
+ * thus never fragments the heap.
+ *
+ * A task can bind an arena as its scratch memory. The scratch functions are
+ * used by the drawing code for its temporary buffers, they take from the
+ * bound arena of the calling task and fall back to the heap without one or if
+ * it is full.
+ */
+
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <esp_err.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Number of tasks that can bind a scratch arena.
+ */
+#ifndef ARENA_SCRATCH_TASKS
+#define ARENA_SCRATCH_TASKS 4
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief An arena.
+ */
+typedef struct
+{
+    uint8_t *base;
+    size_t capacity;
+    size_t used;        /** Bytes in use, allocations are 8 byte aligned */
+    size_t last;        /** Offset of the newest allocation */
+    size_t peak;        /** Most bytes in use since init */
+    uint32_t fallbacks; /** Scratch allocations that went to the heap */
+} arena_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Take the block of an arena from the heap, PSRAM if available.
+ */
+esp_err_t arena_init(arena_t *arena, size_t capacity);
+
+/**
+ * @brief Allocate from an arena.
+ *
+ * @return The memory, 8 byte aligned, or NULL if the arena is full.
+ */
+void *arena_alloc(arena_t *arena, size_t size);
+
+/**
+ * @brief Give back the newest allocation in place, others stay until reset.
+ */
+void arena_free(arena_t *arena, void *ptr);
+
+/**
+ * @brief Check if memory belongs to an arena.
+ */
+bool arena_contains(const arena_t *arena, const void *ptr);
+
+/**
+ * @brief Free all allocations.
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * @brief Return the block to the heap, the arena must not be bound.
+ */
+void arena_deinit(arena_t *arena);
+
+/**
+ * @brief Bind an arena as scratch memory of the calling task.
+ *
+ * @param arena The arena, or NULL to unbind.
+ *
+ * @return ESP_ERR_NO_MEM if all bindings are in use.
+ */
+esp_err_t arena_scratch_bind(arena_t *arena);
+
+/**
+ * @brief Allocate temporary memory, from the scratch arena of the calling
+ *        task if it has room.
+ *
+ * @return The memory, or NULL if out of memory.
+ */
+void *arena_scratch_alloc(size_t size);
+
+/**
+ * @brief Free memory of `arena_scratch_alloc`.
+ *
+ * Memory of a scratch arena is given back in place if it is the newest, else
+ * with the next reset.
+ */
+void arena_scratch_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -63,6 +63,7 @@ typedef enum
 enum DrawFlags
 {
     DRAW_BACKGROUND = 1 << 0, /** Draw a background. Take the background into account when calculating the size. */
+    DRAW_CACHED = 1 << 1,     /** Draw through the rendered-string cache, for text that is drawn again unchanged. */
 };
 
 /**
@@ -159,6 +160,31 @@ void IRAM_ATTR epd_draw_grayscale_image(Rect_t area, uint8_t *data);
  */
 void IRAM_ATTR epd_draw_image(Rect_t area, uint8_t *data, DrawMode_t mode);
 
+/**
+ * @brief Count the pixels of an image per gray level.
+ *
+ * @param area      The image dimensions, as for `epd_draw_image`.
+ * @param data      The image data.
+ * @param histogram 16 bins, one per gray level.
+ */
+void epd_image_histogram(Rect_t area, const uint8_t *data,
+                         uint32_t *histogram);
+
+/**
+ * @brief Draw a picture with a known histogram, see `epd_draw_image`.
+ *
+ * Only frames which change pixels of the used gray levels are output, so
+ * images with few gray levels draw faster.
+ *
+ * @param histogram 16 bins as from `epd_image_histogram`, or NULL to
+ *                  compute it while drawing. Must count every gray level
+ *                  the image uses, the white padding of partial width
+ *                  areas is added here.
+ */
+void IRAM_ATTR epd_draw_image_histogram(Rect_t area, uint8_t *data,
+                                        DrawMode_t mode,
+                                        const uint32_t *histogram);
+
 void IRAM_ATTR epd_draw_frame_1bit(Rect_t area, uint8_t *ptr, DrawMode_t mode, int32_t time);
 
 /**
@@ -354,6 +380,96 @@ typedef struct
     int32_t          descender;      /** Maximal height of a glyph below the base line */
 } GFXfont;
 
+/**
+ * @brief A glyph placed in a text run.
+ */
+typedef struct
+{
+    const GFXglyph *glyph; /** The resolved glyph, after fallback */
+    int16_t x;             /** Pen position relative to the run origin */
+    int16_t y;             /** Base line relative to the run origin */
+    uint32_t offset;       /** Byte offset of the character in the text */
+} GlyphPosition;
+
+/**
+ * @brief A shaped text: UTF-8 decoded and glyphs looked up once, for
+ *        measuring, drawing and hit-testing.
+ *
+ * Glyph positions are stored in caller provided memory. A line feed moves
+ * the pen to the start of the next line.
+ */
+typedef struct
+{
+    const GFXfont *font;
+    FontProperties props;
+    GlyphPosition *glyphs; /** Caller provided glyph storage */
+    uint32_t capacity;     /** Number of entries of `glyphs` */
+    uint32_t count;        /** Number of shaped glyphs */
+    uint32_t bytes;        /** Number of shaped text bytes */
+    int32_t pen_x;         /** Pen position after the last glyph */
+    int32_t pen_y;
+    int32_t min_x;         /** Ink bounds relative to the run origin */
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+} TextRun;
+
+/**
+ * @brief Prepare a text run.
+ *
+ * @param run      The run to initialize.
+ * @param font     The font to shape with.
+ * @param storage  Storage for the glyph positions.
+ * @param capacity Number of glyph positions `storage` can hold.
+ * @param props    The font properties, NULL for the defaults.
+ */
+void text_run_init(TextRun *run, const GFXfont *font, GlyphPosition *storage,
+                   uint32_t capacity, const FontProperties *props);
+
+/**
+ * @brief Append text to a run, continuing at the current pen position.
+ *
+ * @return The text not shaped because the run is full, points to the
+ *         terminating NUL if all text was shaped.
+ */
+const char *text_run_shape(TextRun *run, const char *string);
+
+/**
+ * @brief Recompute the bounds of a run after its glyphs were moved.
+ */
+void text_run_update_bounds(TextRun *run);
+
+/**
+ * @brief Get the bounds of a run when drawn with origin (x, y).
+ */
+void text_run_bounds(const TextRun *run, int32_t x, int32_t y, Rect_t *bounds);
+
+/**
+ * @brief Render a run with its origin at screen position (x, y) into an
+ *        image buffer.
+ *
+ * @param buffer      The image buffer, in the format of `epd_draw_image`.
+ * @param buffer_area The screen area covered by the buffer.
+ */
+void text_run_render(const TextRun *run, int32_t x, int32_t y,
+                     uint8_t *buffer, const Rect_t *buffer_area);
+
+/**
+ * @brief Draw a run with its origin at (x, y).
+ *
+ * @note If framebuffer is NULL, draw mode `mode` is used for direct drawing.
+ */
+void text_run_draw(const TextRun *run, int32_t x, int32_t y,
+                   uint8_t *framebuffer, DrawMode_t mode);
+
+/**
+ * @brief Find the glyph at a position relative to the run origin.
+ *
+ * @return The caret position nearest to x on the line containing y, as the
+ *         index of the glyph following the caret.
+ */
+uint32_t text_run_hit_test(const TextRun *run, int32_t x, int32_t y);
+
 /**
  * @brief Get the text bounds for string, when drawn at (x, y).
  *        Set font properties to NULL to use the defaults.
@@ -372,6 +488,7 @@ void writeln(const GFXfont *font, const char *string, int32_t *cursor_x,
  * @brief Write text to the EPD.
  *
  * @note If framebuffer is NULL, draw mode `mode` is used for direct drawing.
+ *       Strings are cached only with the `DRAW_CACHED` flag.
  */
 void write_mode(const GFXfont *font, const char *string, int32_t *cursor_x,
                 int32_t *cursor_y, uint8_t *framebuffer, DrawMode_t mode,
@@ -382,6 +499,13 @@ void write_mode(const GFXfont *font, const char *string, int32_t *cursor_x,
  */
 void get_glyph(const GFXfont *font, uint32_t code_point, GFXglyph **glyph);
 
+/**
+ * @brief Drop the lookup tables and cached glyphs of a font.
+ *
+ * @note Call before the memory of a font is released or reused.
+ */
+void release_font_cache(const GFXfont *font);
+
 /**
  * @brief Write a (multi-line) string to the EPD.
  */
@@ -0,0 +1,110 @@
+/**
+ * Framebuffer fill and copy operations offloaded to the DMA engine.
+ *
+ * Large aligned blocks are queued on the async memcpy (GDMA) engine, so the
+ * CPU stays free for rendering. Unaligned heads and tails, short operations
+ * and targets without GDMA are handled by the CPU.
+ */
+
+#ifndef _EPD_FB_DMA_H_
+#define _EPD_FB_DMA_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Operations shorter than this are always done by the CPU.
+ */
+#ifndef EPD_FB_DMA_MIN_BYTES
+#define EPD_FB_DMA_MIN_BYTES 1024
+#endif
+
+/**
+ * @brief Maximum number of operations in flight.
+ */
+#ifndef EPD_FB_DMA_MAX_JOBS
+#define EPD_FB_DMA_MAX_JOBS 4
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Completion callback.
+ *
+ * @note May be called from interrupt context, keep it short.
+ */
+typedef void (*epd_fb_dma_cb_t)(void *arg);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Install the DMA engine. Called implicitly by the first operation.
+ */
+void epd_fb_dma_init();
+
+/**
+ * @brief Fill a buffer with a byte value.
+ *
+ * @note `dst` must not be accessed until the operation completed.
+ *
+ * @param dst   The buffer to fill, e.g. a framebuffer.
+ * @param value The byte value, e.g. 0xFF for white.
+ * @param len   Number of bytes to fill.
+ * @param cb    Called when the operation is done, may be NULL.
+ * @param arg   Argument passed to `cb`.
+ */
+void epd_fb_dma_fill(uint8_t *dst, uint8_t value, uint32_t len,
+                     epd_fb_dma_cb_t cb, void *arg);
+
+/**
+ * @brief Copy a buffer.
+ *
+ * @note Neither buffer must be modified until the operation completed.
+ *
+ * @param dst The destination buffer.
+ * @param src The source buffer, must not overlap `dst`.
+ * @param len Number of bytes to copy.
+ * @param cb  Called when the operation is done, may be NULL.
+ * @param arg Argument passed to `cb`.
+ */
+void epd_fb_dma_copy(uint8_t *dst, const uint8_t *src, uint32_t len,
+                     epd_fb_dma_cb_t cb, void *arg);
+
+/**
+ * @brief Returns true while any operation is in flight.
+ */
+bool epd_fb_dma_busy();
+
+/**
+ * @brief Block until all queued operations are done.
+ */
+void epd_fb_dma_wait();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,62 @@
+/**
+ * 64 bit FNV-1a hashing, for fingerprints of content.
+ *
+ * Not suitable against deliberate collisions, only for telling whether
+ * content has changed.
+ */
+
+#ifndef _FNV_H_
+#define _FNV_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Hash of no data, the start value of a hash.
+ */
+#define FNV1A_64_INIT 0xcbf29ce484222325ull
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Continue a hash with more data.
+ *
+ * @param hash `FNV1A_64_INIT`, or the hash of the data before.
+ */
+uint64_t fnv1a_64(uint64_t hash, const void *data, size_t length);
+
+/**
+ * @brief Continue a hash with a NUL terminated string, without the NUL.
+ */
+uint64_t fnv1a_64_string(uint64_t hash, const char *string);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
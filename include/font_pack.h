@@ -0,0 +1,156 @@
+/**
+ * Binary font packs, memory-mapped from a flash partition.
+ *
+ * A pack holds several fonts in the in-memory layout of `GFXfont`, so glyph
+ * tables and bitmaps are used in place and fonts can be updated without
+ * reflashing the app. All multi-byte values are little endian, all tables
+ * are 4 byte aligned. Offsets are relative to the start of the pack:
+ *
+ *     font_pack_header_t
+ *     font_pack_entry_t  [font_count]
+ *     per font: UnicodeInterval [interval_count]
+ *               GFXglyph        [glyph_count]
+ *               bitmap          [bitmap_size]
+ */
+
+#ifndef _FONT_PACK_H_
+#define _FONT_PACK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_driver.h"
+
+#include <esp_err.h>
+
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Pack file magic, "EPDF".
+ */
+#define FONT_PACK_MAGIC 0x46445045
+
+/**
+ * @brief Current pack format version.
+ */
+#define FONT_PACK_VERSION 1
+
+/**
+ * @brief Maximum length of a font name, including the terminating NUL.
+ */
+#define FONT_PACK_NAME_LEN 24
+
+/**
+ * @brief Maximum number of registered fonts.
+ */
+#ifndef FONT_PACK_MAX_FONTS
+#define FONT_PACK_MAX_FONTS 16
+#endif
+
+/**
+ * @brief Maximum number of mounted packs.
+ */
+#ifndef FONT_PACK_MAX_PACKS
+#define FONT_PACK_MAX_PACKS 2
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Pack header.
+ */
+typedef struct
+{
+    uint32_t magic;      /** `FONT_PACK_MAGIC` */
+    uint16_t version;    /** `FONT_PACK_VERSION` */
+    uint16_t font_count; /** Number of directory entries */
+    uint32_t size;       /** Size of the pack in bytes */
+    uint32_t reserved;
+} font_pack_header_t;
+
+/**
+ * @brief Directory entry of a font.
+ */
+typedef struct
+{
+    char name[FONT_PACK_NAME_LEN]; /** Font family, NUL terminated */
+    uint16_t size;                 /** Font size in points */
+    uint8_t compressed;            /** Bitmaps are zlib compressed */
+    uint8_t advance_y;             /** Newline distance */
+    int32_t ascender;
+    int32_t descender;
+    uint32_t interval_offset;
+    uint32_t interval_count;
+    uint32_t glyph_offset;
+    uint32_t glyph_count;
+    uint32_t bitmap_offset;
+    uint32_t bitmap_size;
+} font_pack_entry_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Map a font pack partition and register its fonts.
+ *
+ * @param label The label of the data partition holding the pack.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no such partition,
+ *         ESP_ERR_INVALID_VERSION for packs of other versions,
+ *         ESP_ERR_INVALID_RESPONSE for corrupt packs,
+ *         ESP_ERR_NO_MEM if the registry is full.
+ */
+esp_err_t font_pack_mount(const char *label);
+
+/**
+ * @brief Unregister the fonts of all packs and unmap them.
+ *
+ * @note Fonts obtained from `font_pack_get` must not be used afterwards.
+ */
+void font_pack_unmount_all();
+
+/**
+ * @brief Find a registered font.
+ *
+ * @param name The font family.
+ * @param size The font size, 0 for any size.
+ *
+ * @return The font, or NULL if no such font is registered.
+ */
+const GFXfont *font_pack_get(const char *name, uint16_t size);
+
+/**
+ * @brief Number of registered fonts.
+ */
+uint32_t font_pack_count();
+
+/**
+ * @brief Get a registered font by index, with its name and size.
+ */
+const GFXfont *font_pack_get_index(uint32_t index, const char **name,
+                                   uint16_t *size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
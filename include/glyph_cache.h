@@ -0,0 +1,92 @@
+/**
+ * Decompression cache for glyph bitmaps of compressed fonts.
+ *
+ * Glyphs are inflated on first use and kept in a fixed-size LRU cache, so
+ * characters repeated on a page are only decompressed once.
+ */
+
+#ifndef _GLYPH_CACHE_H_
+#define _GLYPH_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_driver.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Maximum number of cached glyphs.
+ */
+#ifndef GLYPH_CACHE_ENTRIES
+#define GLYPH_CACHE_ENTRIES 128
+#endif
+
+/**
+ * @brief Maximum number of bytes of cached glyph bitmaps.
+ */
+#ifndef GLYPH_CACHE_BYTES
+#define GLYPH_CACHE_BYTES (64 * 1024)
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Cache counters, accumulated since the last reset.
+ */
+typedef struct
+{
+    uint32_t hits;      /** Glyphs found in the cache. */
+    uint32_t misses;    /** Glyphs decompressed. */
+    uint32_t evictions; /** Glyphs dropped to make room. */
+    uint32_t errors;    /** Glyphs which failed to decompress. */
+    uint32_t bytes;     /** Bytes currently cached. */
+} glyph_cache_stats_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Get the uncompressed bitmap of a glyph of a compressed font.
+ *
+ * @note The bitmap stays valid until the next call.
+ *
+ * @return The 4 bit per pixel bitmap, or NULL if the glyph data is invalid
+ *         or no memory is available.
+ */
+const uint8_t *glyph_cache_get(const GFXfont *font, const GFXglyph *glyph);
+
+/**
+ * @brief Drop all cached glyphs.
+ */
+void glyph_cache_clear();
+
+/**
+ * @brief Get the cache counters.
+ */
+void glyph_cache_get_stats(glyph_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
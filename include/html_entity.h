@@ -0,0 +1,107 @@
+/**
+ * Decoding of HTML character references.
+ *
+ * Named references of markup, typography and the Czech and Slovak letters are
+ * known, as are decimal and hexadecimal numeric references. Text is decoded
+ * in a single pass, either in place for UTF-8 text or while converting text
+ * of a single byte encoding to UTF-8. Unknown references are kept as they
+ * are.
+ */
+
+#ifndef _HTML_ENTITY_H_
+#define _HTML_ENTITY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Longest reference decoded, `&#x10FFFF;`.
+ */
+#define HTML_ENTITY_MAX_LENGTH 10
+
+/**
+ * @brief Decode `&nbsp;` as a plain space, for fonts without U+00A0 and to
+ *        let the text wrap there.
+ */
+#define HTML_ENTITY_NBSP_SPACE (1 << 0)
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Maps a byte of a single byte encoding to its code point.
+ */
+typedef uint32_t (*html_entity_charset_t)(uint8_t byte);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Decode the reference at the start of some text.
+ *
+ * Invalid numeric references decode to U+FFFD, references to C1 controls
+ * to the Windows-1252 characters they mean, as browsers do.
+ *
+ * @param text Text starting with `&`.
+ *
+ * @return The length of the reference, 0 if the text does not start with a
+ *         known one.
+ */
+size_t html_entity_parse(const char *text, size_t length,
+                         uint32_t *code_point);
+
+/**
+ * @brief Decode the references of UTF-8 text in place.
+ *
+ * A reference is never shorter than its UTF-8 encoding, so the text can
+ * only shrink.
+ *
+ * @param flags `HTML_ENTITY_*` flags.
+ *
+ * @return The new length, the text is not NUL terminated.
+ */
+size_t html_entity_decode(char *text, size_t length, uint32_t flags);
+
+/**
+ * @brief Convert text to UTF-8 and decode its references on the way.
+ *
+ * Converts as much input as fits into the output, a character or reference
+ * is never split. The output is not NUL terminated.
+ *
+ * @param charset  Code points of the input bytes, NULL for UTF-8 input,
+ *                 which is copied as it is.
+ * @param consumed Set to the number of input bytes converted.
+ * @param flags    `HTML_ENTITY_*` flags.
+ *
+ * @return The number of bytes written to `out`.
+ */
+size_t html_entity_to_utf8(const char *in, size_t in_length, size_t *consumed,
+                           char *out, size_t out_capacity,
+                           html_entity_charset_t charset, uint32_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -23,6 +23,45 @@ extern "C" {
 /***        macro definitions                                               ***/
 /******************************************************************************/
 
+/**
+ * @brief Select the bus backend: 1 drives the I2S peripheral registers
+ *        directly, 0 uses the esp_lcd i80 driver.
+ */
+#ifndef USER_I2S_REG
+#define USER_I2S_REG 0
+#endif
+
+/**
+ * @brief Wire order of a line buffer.
+ *
+ * Line buffers are always written in final DMA byte order, so no per-row
+ * reordering is needed before transmission. Within a byte, the first pixel
+ * occupies the two most significant bits and the data pins are routed in
+ * order (D7 = bit 7). The I2S FIFO in LCD mode transmits the upper 16-bit
+ * half of each 32-bit word first, so with direct register access the halves
+ * of every word are stored swapped.
+ */
+#if USER_I2S_REG
+#define I2S_WIRE_HALFWORD_SWAP 2
+#else
+#define I2S_WIRE_HALFWORD_SWAP 0
+#endif
+
+/**
+ * @brief Buffer index of the n-th byte on the wire.
+ */
+#define I2S_WIRE_BYTE_INDEX(n) ((n) ^ I2S_WIRE_HALFWORD_SWAP)
+
+/**
+ * @brief Bit shift placing the n-th wire byte (0..3) in a 32-bit word.
+ */
+#define I2S_WIRE_BYTE_SHIFT(n) (8 * ((n) ^ I2S_WIRE_HALFWORD_SWAP))
+
+/**
+ * @brief Bit shift of the n-th pixel (0..3) within a wire byte.
+ */
+#define I2S_WIRE_PIXEL_SHIFT(n) (2 * (3 - (n)))
+
 /******************************************************************************/
 /***        type definitions                                                ***/
 /******************************************************************************/
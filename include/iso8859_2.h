@@ -0,0 +1,64 @@
+/**
+ * ISO-8859-2 (Latin-2) to Unicode conversion.
+ *
+ * The lower half is ASCII and C1 controls, the upper half is mapped by a
+ * 96 entry table. Conversion is stateless, so text can be converted chunk
+ * by chunk as it arrives.
+ */
+
+#ifndef _ISO8859_2_H_
+#define _ISO8859_2_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief The code point of an ISO-8859-2 byte.
+ */
+uint32_t iso8859_2_code_point(uint8_t byte);
+
+/**
+ * @brief Convert a chunk of ISO-8859-2 text to UTF-8.
+ *
+ * Converts as much input as fits into the output, a character is never
+ * split. The output is not NUL terminated.
+ *
+ * @param consumed Set to the number of input bytes converted.
+ *
+ * @return The number of bytes written to `out`.
+ */
+size_t iso8859_2_to_utf8(const char *in, size_t in_length, size_t *consumed,
+                         char *out, size_t out_capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,131 @@
+/**
+ * Prefetch framebuffer rows from external PSRAM into internal SRAM.
+ *
+ * While the producer converts row i, rows i+1 .. i+n are already being
+ * copied by the async memcpy (GDMA) engine. Targets without async memcpy
+ * fall back to a CPU copy.
+ */
+
+#ifndef _ROW_PREFETCH_H_
+#define _ROW_PREFETCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <esp_attr.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Number of rows in flight, including the row being consumed.
+ */
+#ifndef ROW_PREFETCH_DEPTH
+#define ROW_PREFETCH_DEPTH 4
+#endif
+
+/**
+ * @brief Maximum number of bytes prefetched per row.
+ */
+#ifndef ROW_PREFETCH_MAX_ROW_BYTES
+#define ROW_PREFETCH_MAX_ROW_BYTES 480
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Prefetch counters, accumulated since the last reset.
+ */
+typedef struct
+{
+    uint32_t rows;             /** Rows handed out to the consumer. */
+    uint32_t dma_rows;         /** Rows copied by the DMA engine. */
+    uint32_t stalls;           /** Rows the consumer had to wait for. */
+    uint64_t stall_cycles;     /** CPU cycles spent waiting for / copying PSRAM rows. */
+    uint32_t max_stall_cycles; /** Longest single wait in CPU cycles. */
+} row_prefetch_stats_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Allocate the internal row slots and install the DMA engine.
+ */
+void row_prefetch_init();
+
+/**
+ * @brief Returns true if rows are copied by DMA on this target.
+ */
+bool row_prefetch_uses_dma();
+
+/**
+ * @brief Make CPU writes to a PSRAM region visible to the DMA engine.
+ *
+ * @note Call once before prefetching rows of a region that was just written.
+ */
+void row_prefetch_sync(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Start prefetching a sequence of rows.
+ *
+ * @param first_row Address of the first row.
+ * @param stride    Distance between two rows in bytes.
+ * @param row_bytes Number of bytes to fetch per row, clamped to
+ *                  `ROW_PREFETCH_MAX_ROW_BYTES`.
+ * @param rows      Number of rows.
+ */
+void row_prefetch_begin(const uint8_t *first_row, uint32_t stride,
+                        uint32_t row_bytes, int32_t rows);
+
+/**
+ * @brief Get the next row in internal memory.
+ *
+ * @note Rows must be requested in order. The returned buffer stays valid
+ *       until the next call.
+ */
+const uint8_t * IRAM_ATTR row_prefetch_next();
+
+/**
+ * @brief Skip the next row without waiting for it.
+ */
+void IRAM_ATTR row_prefetch_skip();
+
+/**
+ * @brief Wait for outstanding copies and release the sequence.
+ */
+void row_prefetch_end();
+
+/**
+ * @brief Get the prefetch counters.
+ */
+void row_prefetch_get_stats(row_prefetch_stats_t *stats);
+
+/**
+ * @brief Reset the prefetch counters.
+ */
+void row_prefetch_reset_stats();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,101 @@
+/**
+ * Collect text for a single panel update.
+ *
+ * Text runs and layouts are rendered into one buffer covering all of them,
+ * which is drawn with a single `epd_draw_image`. Rows between the texts are
+ * white and skipped by the driver, so the update time depends on the rows
+ * covered by text rather than on the number of lines.
+ */
+
+#ifndef _TEXT_BATCH_H_
+#define _TEXT_BATCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_driver.h"
+#include "text_layout.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A text run placed on the screen.
+ */
+typedef struct
+{
+    const TextRun *run; /** The run, must stay valid until drawn */
+    int32_t x;          /** Screen position of the run origin */
+    int32_t y;
+} TextBatchItem;
+
+/**
+ * @brief Texts to draw at once.
+ */
+typedef struct
+{
+    TextBatchItem *items; /** Caller provided item storage */
+    uint32_t capacity;    /** Number of entries of `items` */
+    uint32_t count;       /** Number of added items */
+    Rect_t area;          /** Screen area covering all items */
+} TextBatch;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Prepare an empty batch.
+ */
+void text_batch_init(TextBatch *batch, TextBatchItem *storage,
+                     uint32_t capacity);
+
+/**
+ * @brief Add a run with its origin at (x, y).
+ *
+ * @return false if the batch is full.
+ */
+bool text_batch_add_run(TextBatch *batch, const TextRun *run, int32_t x,
+                        int32_t y);
+
+/**
+ * @brief Add a layout with its first base line at (x, y).
+ *
+ * @return false if the batch is full.
+ */
+bool text_batch_add_layout(TextBatch *batch, const TextLayout *layout,
+                           int32_t x, int32_t y);
+
+/**
+ * @brief Draw all items and empty the batch.
+ *
+ * @note If framebuffer is NULL, the items are drawn to the display in a
+ *       single update with draw mode `mode`.
+ */
+void text_batch_draw(TextBatch *batch, uint8_t *framebuffer, DrawMode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
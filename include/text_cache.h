@@ -0,0 +1,177 @@
+/**
+ * Cache of rendered strings, for labels and other repeated text.
+ *
+ * A string is rasterized once into a 4 bit per pixel image, together with a
+ * mask of the pixels covered by glyph boxes. Later draws of the same string
+ * with the same font and properties copy the image instead of decoding and
+ * compositing glyphs again. Images live in PSRAM if available, the cache
+ * evicts the least recently used strings to stay below its memory limit.
+ *
+ * Only strings drawn with the `DRAW_CACHED` flag are cached, text that changes
+ * between draws would evict the labels without ever being hit.
+ */
+
+#ifndef _TEXT_CACHE_H_
+#define _TEXT_CACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_driver.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Default memory limit of cached images and masks.
+ */
+#ifndef TEXT_CACHE_BYTES
+#define TEXT_CACHE_BYTES (128 * 1024)
+#endif
+
+/**
+ * @brief Maximum number of cached strings.
+ */
+#ifndef TEXT_CACHE_ENTRIES
+#define TEXT_CACHE_ENTRIES 32
+#endif
+
+/**
+ * @brief Longer strings are not cached.
+ */
+#ifndef TEXT_CACHE_MAX_STRING
+#define TEXT_CACHE_MAX_STRING 256
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Identifies a rendered string.
+ */
+typedef struct
+{
+    const GFXfont *font;
+    uint64_t hash;      /** Hash of the string bytes */
+    uint32_t length;    /** String length in bytes */
+    FontProperties props;
+    uint8_t x_parity;   /** Nibble phase of the screen position */
+} text_cache_key_t;
+
+/**
+ * @brief A rendered string.
+ */
+typedef struct
+{
+    /// Image area relative to the string origin. The image starts on a
+    /// byte boundary of the framebuffer: `x` has the parity of the key.
+    Rect_t area;
+    /// Pen position after the string, relative to the origin.
+    int32_t pen_x;
+    int32_t pen_y;
+    /// Image in the format of `epd_draw_image`, white outside glyphs.
+    uint8_t *image;
+    /// One bit per pixel, set for pixels the string draws. Row stride is
+    /// `(area.width + 7) / 8`.
+    uint8_t *mask;
+} text_cache_entry_t;
+
+/**
+ * @brief Cache counters, accumulated since the last reset.
+ */
+typedef struct
+{
+    uint32_t hits;      /** Strings drawn from the cache. */
+    uint32_t misses;    /** Strings rendered. */
+    uint32_t evictions; /** Strings dropped to make room. */
+    uint32_t entries;   /** Strings currently cached. */
+    uint32_t bytes;     /** Bytes currently used. */
+} text_cache_stats_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Set the memory limit, 0 disables the cache.
+ */
+void text_cache_set_limit(uint32_t bytes);
+
+/**
+ * @brief Drop all cached strings.
+ */
+void text_cache_clear();
+
+/**
+ * @brief Get the cache counters.
+ */
+void text_cache_get_stats(text_cache_stats_t *stats);
+
+/**
+ * @brief Reset the hit, miss and eviction counters.
+ */
+void text_cache_reset_stats();
+
+/**
+ * @brief Build the key of a string.
+ *
+ * @return false if the string is not cacheable.
+ */
+bool text_cache_key(text_cache_key_t *key, const GFXfont *font,
+                    const char *string, const FontProperties *props,
+                    int32_t x);
+
+/**
+ * @brief Find a rendered string and mark it as recently used.
+ *
+ * @return The entry, or NULL on a miss.
+ */
+const text_cache_entry_t *text_cache_lookup(const text_cache_key_t *key);
+
+/**
+ * @brief Add a string, its image is white and its mask empty.
+ *
+ * @param area The image area relative to the string origin, `x` must have
+ *             the parity of `key->x_parity`.
+ *
+ * @return The entry to render into, or NULL if the string does not fit.
+ */
+text_cache_entry_t *text_cache_insert(const text_cache_key_t *key,
+                                      Rect_t area);
+
+/**
+ * @brief Set the mask of a box of an entry, in image coordinates.
+ */
+void text_cache_mark(text_cache_entry_t *entry, int32_t x, int32_t y,
+                     int32_t width, int32_t height);
+
+/**
+ * @brief Copy the masked pixels of an entry to a framebuffer.
+ *
+ * @param x, y The screen position of the string origin.
+ */
+void text_cache_blit(const text_cache_entry_t *entry, int32_t x, int32_t y,
+                     uint8_t *framebuffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,108 @@
+/**
+ * Paragraph layout with word wrapping, based on the glyph advances of a font.
+ *
+ * Text is shaped into a text run once, then broken greedily into lines no
+ * wider than the layout width. Lines break after spaces and punctuation,
+ * words longer than a line are split. Line feeds force a break.
+ */
+
+#ifndef _TEXT_LAYOUT_H_
+#define _TEXT_LAYOUT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_driver.h"
+
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A line of a layout.
+ */
+typedef struct
+{
+    uint32_t first;  /** Index of the first glyph in the layout run */
+    uint32_t count;  /** Number of glyphs, including trailing spaces */
+    uint32_t start;  /** Byte offset of the line in the text */
+    uint32_t end;    /** Byte offset after the last character of the line */
+    int32_t width;   /** Advance width without trailing spaces, in pixels */
+    int32_t y;       /** Base line relative to the layout origin */
+} LineBox;
+
+/**
+ * @brief A laid out paragraph.
+ */
+typedef struct
+{
+    TextRun run;            /** The glyphs, positioned line by line */
+    LineBox *lines;         /** Caller provided line storage */
+    uint32_t line_capacity; /** Number of entries of `lines` */
+    uint32_t line_count;    /** Number of laid out lines */
+    int32_t width;          /** Maximum line width in pixels */
+    int32_t height;         /** Distance from the first to after the last base line */
+} TextLayout;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Prepare a layout.
+ *
+ * @param layout         The layout to initialize.
+ * @param font           The font to lay out with.
+ * @param glyphs         Storage for the glyph positions.
+ * @param glyph_capacity Number of glyph positions `glyphs` can hold.
+ * @param lines          Storage for the lines.
+ * @param line_capacity  Number of lines `lines` can hold.
+ * @param width          Maximum line width in pixels.
+ * @param props          The font properties, NULL for the defaults.
+ */
+void text_layout_init(TextLayout *layout, const GFXfont *font,
+                      GlyphPosition *glyphs, uint32_t glyph_capacity,
+                      LineBox *lines, uint32_t line_capacity, int32_t width,
+                      const FontProperties *props);
+
+/**
+ * @brief Lay out a text, replacing the previous content of the layout.
+ *
+ * @note If the storage is too small, only complete lines are kept.
+ *
+ * @return The text which did not fit, points to the terminating NUL if all
+ *         text was laid out.
+ */
+const char *text_layout_set_text(TextLayout *layout, const char *text);
+
+/**
+ * @brief Draw a layout with the first base line at (x, y).
+ *
+ * @note If framebuffer is NULL, draw mode `mode` is used for direct drawing.
+ */
+void text_layout_draw(const TextLayout *layout, int32_t x, int32_t y,
+                      uint8_t *framebuffer, DrawMode_t mode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
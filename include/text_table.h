@@ -0,0 +1,231 @@
+/**
+ * Tables of text, drawn as a grid with wrapped cells.
+ *
+ * A table is filled cell by cell and row by row, for example from the events
+ * of the HTML table parser. Cell text is copied into caller provided storage.
+ * Drawing measures the columns with the font metrics, shares the available
+ * width between them and wraps the cells to their column.
+ */
+
+#ifndef _TEXT_TABLE_H_
+#define _TEXT_TABLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "epd_driver.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Maximum number of columns, cells right of it are dropped.
+ */
+#ifndef TEXT_TABLE_MAX_COLUMNS
+#define TEXT_TABLE_MAX_COLUMNS 8
+#endif
+
+/**
+ * @brief Maximum number of glyphs of a cell, the rest is not drawn.
+ */
+#ifndef TEXT_TABLE_CELL_GLYPHS
+#define TEXT_TABLE_CELL_GLYPHS 256
+#endif
+
+/**
+ * @brief Maximum number of lines of a cell.
+ */
+#ifndef TEXT_TABLE_CELL_LINES
+#define TEXT_TABLE_CELL_LINES 16
+#endif
+
+/**
+ * @brief Space between the grid and the cell text in pixels.
+ */
+#ifndef TEXT_TABLE_PADDING
+#define TEXT_TABLE_PADDING 6
+#endif
+
+/**
+ * @brief Rows with their own hash in a fingerprint, the rows after the last
+ *        one share its hash.
+ */
+#ifndef TEXT_TABLE_TRACKED_ROWS
+#define TEXT_TABLE_TRACKED_ROWS 64
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A cell of a table.
+ */
+typedef struct
+{
+    uint16_t row;
+    uint16_t column;
+    uint32_t offset; /** NUL terminated UTF-8 text in the table text storage */
+} TableCell;
+
+/**
+ * @brief A table, in row-major order.
+ */
+typedef struct
+{
+    TableCell *cells;       /** Caller provided cell storage */
+    uint32_t cell_capacity; /** Number of entries of `cells` */
+    uint32_t cell_count;
+    char *text;             /** Caller provided text storage */
+    uint32_t text_capacity; /** Size of `text` in bytes */
+    uint32_t text_length;
+    int32_t caption;        /** Offset of the caption text, -1 if none */
+    uint16_t row_count;     /** Number of rows, the current one included */
+    uint16_t column_count;  /** Number of columns of the widest row */
+    uint16_t column;        /** Column of the next cell */
+} TextTable;
+
+/**
+ * @brief Hashes of a table, to find what changed since it was drawn.
+ *
+ * Holds no pointers, it can be kept in RTC memory across deep sleep.
+ */
+typedef struct
+{
+    uint64_t content;  /** Caption and cells, 0 if nothing is shown */
+    uint64_t layout;   /** Font, position and grid, set by drawing */
+    Rect_t area;       /** Drawn area, set by drawing */
+    uint32_t caption;  /** Caption text */
+    uint16_t row_count;
+    uint32_t rows[TEXT_TABLE_TRACKED_ROWS]; /** Cells of each row */
+} TableFingerprint;
+
+/**
+ * @brief What `text_table_update` drew.
+ */
+typedef enum
+{
+    TEXT_TABLE_UNCHANGED, /** Nothing, the table is shown already */
+    TEXT_TABLE_PARTIAL,   /** The caption or rows that changed */
+    TEXT_TABLE_REDRAWN,   /** The whole table */
+} TableUpdate;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Prepare an empty table.
+ */
+void text_table_init(TextTable *table, TableCell *cells, uint32_t cell_capacity,
+                     char *text, uint32_t text_capacity);
+
+/**
+ * @brief Set the caption shown above the grid.
+ *
+ * @return false if the text storage is full.
+ */
+bool text_table_set_caption(TextTable *table, const char *text,
+                            uint32_t length);
+
+/**
+ * @brief Append a cell to the current row.
+ *
+ * @return false if the storage is full or the row has
+ *         `TEXT_TABLE_MAX_COLUMNS` cells already.
+ */
+bool text_table_add_cell(TextTable *table, const char *text, uint32_t length);
+
+/**
+ * @brief Start a new row, empty rows are not kept.
+ */
+void text_table_end_row(TextTable *table);
+
+/**
+ * @brief Get the text of a cell.
+ *
+ * @return The text, or NULL if the row has no such cell.
+ */
+const char *text_table_cell(const TextTable *table, uint32_t row,
+                            uint32_t column);
+
+/**
+ * @brief Draw a table with its top left corner at (x, y).
+ *
+ * The grid is drawn in `line_color`, the text with the default font
+ * properties.
+ *
+ * @param width The maximum width of the table.
+ *
+ * @note If framebuffer is NULL, the table is rendered into a buffer of its
+ *       area and drawn in a single update with draw mode `mode`.
+ *
+ * @return The height of the table, including the caption.
+ */
+int32_t text_table_draw(const TextTable *table, const GFXfont *font,
+                        int32_t x, int32_t y, int32_t width,
+                        uint8_t line_color, uint8_t *framebuffer,
+                        DrawMode_t mode);
+
+/**
+ * @brief Serialize a table, for storing it.
+ *
+ * @return The size of the packed table, it is written only if it fits
+ *         `capacity`.
+ */
+uint32_t text_table_pack(const TextTable *table, void *data, uint32_t capacity);
+
+/**
+ * @brief Restore a table from `text_table_pack` data into its storage.
+ *
+ * @return false if the data is corrupt or does not fit, the table is empty
+ *         then.
+ */
+bool text_table_unpack(TextTable *table, const void *data, uint32_t length);
+
+/**
+ * @brief Hash the content of a table.
+ *
+ * Equal content gives equal fingerprints, so comparing `content` tells
+ * whether a table needs to be drawn at all.
+ */
+void text_table_fingerprint(const TextTable *table,
+                            TableFingerprint *fingerprint);
+
+/**
+ * @brief Bring a table on the display up to date.
+ *
+ * Compares the table with the fingerprint of the one on the display. If the
+ * grid has the same geometry, only the caption and the runs of rows whose
+ * cells differ are cleared and drawn, otherwise the whole table is. Unchanged
+ * content is not drawn at all.
+ *
+ * @param shown The fingerprint of the table on the display, content 0 if
+ *              there is none, updated to the new table.
+ */
+TableUpdate text_table_update(const TextTable *table, const GFXfont *font,
+                              int32_t x, int32_t y, int32_t width,
+                              uint8_t line_color, DrawMode_t mode,
+                              TableFingerprint *shown);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
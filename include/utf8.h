@@ -0,0 +1,84 @@
+/**
+ * Validating UTF-8 decoding.
+ *
+ * Malformed input (stray continuation bytes, overlong encodings, surrogates,
+ * code points above U+10FFFF and truncated sequences) decodes to
+ * `UTF8_INVALID`, one value per maximal invalid subsequence. Decoding never
+ * reads past the terminating NUL of a string.
+ */
+
+#ifndef _UTF8_H_
+#define _UTF8_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Result of decoding a malformed sequence, not a valid code point.
+ */
+#define UTF8_INVALID 0xFFFFFFFF
+
+/**
+ * @brief Maximum length of an encoded code point in bytes.
+ */
+#define UTF8_MAX_LENGTH 4
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Decode the next code point and advance the string past it.
+ *
+ * @return The code point, `UTF8_INVALID` for malformed input, or 0 at the end
+ *         of the string, which is not advanced then.
+ */
+uint32_t utf8_next(const char **string);
+
+/**
+ * @brief Length of the leading run of ASCII characters, excluding NUL.
+ *
+ * Scans a word at a time, the run may be decoded byte by byte without
+ * `utf8_next`.
+ *
+ * @param max Maximum number of bytes to scan.
+ */
+uint32_t utf8_ascii_span(const char *string, uint32_t max);
+
+/**
+ * @brief Encode a code point.
+ *
+ * @param out At least `UTF8_MAX_LENGTH` bytes, not NUL terminated.
+ *
+ * @return The number of bytes written, 0 for surrogates and values above
+ *         U+10FFFF.
+ */
+uint32_t utf8_encode(uint32_t cp, char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
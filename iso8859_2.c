@@ -0,0 +1,92 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "iso8859_2.h"
+#include "utf8.h"
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/**
+ * @brief Code points of the bytes 0xA0 to 0xFF.
+ */
+static const uint16_t upper_half[96] = {
+    0x00A0, 0x0104, 0x02D8, 0x0141, 0x00A4, 0x013D, 0x015A, 0x00A7,
+    0x00A8, 0x0160, 0x015E, 0x0164, 0x0179, 0x00AD, 0x017D, 0x017B,
+    0x00B0, 0x0105, 0x02DB, 0x0142, 0x00B4, 0x013E, 0x015B, 0x02C7,
+    0x00B8, 0x0161, 0x015F, 0x0165, 0x017A, 0x02DD, 0x017E, 0x017C,
+    0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+    0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+    0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+    0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+    0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+    0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+    0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+    0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9,
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+uint32_t iso8859_2_code_point(uint8_t byte)
+{
+    return byte < 0xA0 ? byte : upper_half[byte - 0xA0];
+}
+
+
+size_t iso8859_2_to_utf8(const char *in, size_t in_length, size_t *consumed,
+                         char *out, size_t out_capacity)
+{
+    const uint8_t *src = (const uint8_t *)in;
+    size_t i = 0;
+    size_t n = 0;
+
+    while (i < in_length)
+    {
+        uint8_t byte = src[i];
+        if (byte < 0x80)
+        {
+            if (n == out_capacity)
+            {
+                break;
+            }
+            out[n++] = byte;
+        }
+        else
+        {
+            // all code points of the encoding are two bytes in UTF-8.
+            if (out_capacity - n < 2)
+            {
+                break;
+            }
+            n += utf8_encode(iso8859_2_code_point(byte), &out[n]);
+        }
+        i++;
+    }
+
+    *consumed = i;
+    return n;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
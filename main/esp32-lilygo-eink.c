@@ -0,0 +1,652 @@
+// ESP32 application which downloads a text file into memory and prints it to the console.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_wifi.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_system.h"
+#include "esp_event.h"
+#include "esp_sleep.h"
+#include "nvs_flash.h"
+#include "esp_http_client.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_vfs_fat.h"
+#include "sdmmc_cmd.h"
+#include "credentials.h"
+
+#include "freertos/semphr.h"
+#include "bsp/esp-bsp.h"
+#include "arena.h"
+#include "epd_driver.h"
+#include "epd_fb_dma.h"
+#include "fetch.h"
+#include "fnv.h"
+#include "html_entity.h"
+#include "html_table.h"
+#include "iso8859_2.h"
+#include "msg_pool.h"
+#include "poll_schedule.h"
+#include "snapshot.h"
+#include "text_batch.h"
+#include "text_layout.h"
+#include "text_table.h"
+
+#include "font/firasans.h"
+
+#include <inttypes.h>
+#include <sys/time.h>
+
+static SemaphoreHandle_t downloadSemaphore;
+uint8_t *framebuffer = NULL;
+
+// TAG for loggin
+static const char *TAG = "esp32-lilygo-eink";
+static SemaphoreHandle_t displayUpdateSemaphore = NULL;
+
+
+// Kinds of display messages, only a pointer to the content is queued.
+enum {
+    DISPLAY_TEXT,   // NUL terminated UTF-8 text
+    DISPLAY_TABLE,  // a TableContent
+};
+
+#define DISPLAY_QUEUE_LENGTH 4
+static QueueHandle_t displayQueue = NULL;
+
+// The display task is started by the first message, a wake that draws nothing skips the EPD.
+static TaskHandle_t display_task_handle = NULL;
+// Messages posted and handled, coalesced ones included, and the content changes drawn.
+static volatile uint32_t display_posted = 0;
+static volatile uint32_t display_handled = 0;
+static volatile uint32_t display_changes = 0;
+static void post_display(msg_buffer_t *msg);
+
+// Temporary memory of an update, reset at once when it is done instead of freed piece by piece.
+// The render arena holds a full screen image.
+#define RENDER_ARENA_SIZE (EPD_WIDTH * EPD_HEIGHT / 2 + 32 * 1024)
+static arena_t render_arena;
+
+// A parsed table, filled in a message buffer and handed to the display task.
+#define MAX_TABLE_CELLS 128
+#define MAX_TABLE_TEXT 4096
+typedef struct {
+    TextTable table;
+    TableCell cells[MAX_TABLE_CELLS];
+    char text[MAX_TABLE_TEXT];
+} TableContent;
+
+
+// Text layout storage, more glyphs than this do not fit on the display anyway.
+#define TEXT_MARGIN 10
+#define MAX_TEXT_GLYPHS 1024
+#define MAX_TEXT_LINES 32
+static GlyphPosition text_glyphs[MAX_TEXT_GLYPHS];
+static LineBox text_lines[MAX_TEXT_LINES];
+
+// What the panel shows, kept across deep sleep since the panel keeps its image.
+// Both are 0 after power on, when the panel content is unknown.
+RTC_DATA_ATTR static uint64_t shown_text = 0;
+RTC_DATA_ATTR static TableFingerprint shown_table;
+
+// The content on the panel, persisted to know it after a reset as well.
+#define SNAPSHOT_PATH BSP_SPIFFS_MOUNT_POINT "/display.snp"
+static bool snapshot_mounted = false;
+static bool snapshot_enabled = false;
+
+// SPIFFS is mounted on first use, a wake with nothing to save does not pay for it.
+static bool mount_snapshot(void) {
+    if (!snapshot_mounted) {
+        snapshot_mounted = true;
+        snapshot_enabled = bsp_spiffs_mount() == ESP_OK;
+        if (!snapshot_enabled) {
+            ESP_LOGW(TAG, "No SPIFFS, the display content is not kept across resets");
+        }
+    }
+    return snapshot_enabled;
+}
+
+static bool content_changed(const msg_buffer_t *msg) {
+    if (msg->type == DISPLAY_TABLE) {
+        TableFingerprint fingerprint;
+        text_table_fingerprint(&((const TableContent *)msg->data)->table, &fingerprint);
+        return fingerprint.content != shown_table.content;
+    }
+    return fnv1a_64_string(FNV1A_64_INIT, (const char *)msg->data) != shown_text;
+}
+
+void draw_text(const char *text) {
+    printf("Drawing text: %s\n", text);
+    epd_clear();
+
+    // wrap by glyph advances to the display width.
+    TextLayout layout;
+    text_layout_init(&layout, &FiraSans, text_glyphs,
+                     sizeof(text_glyphs) / sizeof(text_glyphs[0]), text_lines,
+                     MAX_TEXT_LINES, EPD_WIDTH - 2 * TEXT_MARGIN, NULL);
+    const char *rest = text_layout_set_text(&layout, text);
+    if (*rest != '\0') {
+        ESP_LOGW(TAG, "text does not fit, dropped: %s", rest);
+    }
+    ESP_LOGD(TAG, "Drawing %lu lines", (unsigned long)layout.line_count);
+
+    // all lines go to the panel in a single update.
+    TextBatchItem items[1];
+    TextBatch batch;
+    text_batch_init(&batch, items, 1);
+    text_batch_add_layout(&batch, &layout, TEXT_MARGIN,
+                          FiraSans.ascender + TEXT_MARGIN);
+    text_batch_draw(&batch, NULL, BLACK_ON_WHITE);
+
+    // epd_draw_grayscale_image(epd_full_screen(), framebuffer);
+    epd_poweroff();
+
+    shown_text = fnv1a_64_string(FNV1A_64_INIT, text);
+    memset(&shown_table, 0, sizeof(shown_table));
+}
+
+
+void draw_table(const TextTable *table) {
+    ESP_LOGD(TAG, "Drawing table: %u rows, %u columns", table->row_count, table->column_count);
+    // text or unknown content is cleared, a shown table is updated where it differs.
+    if (shown_table.content == 0) {
+        epd_clear();
+    }
+    shown_text = 0;
+
+    // columns are fitted to the display width, cells wrap inside them.
+    TableUpdate update = text_table_update(table, &FiraSans, TEXT_MARGIN, TEXT_MARGIN,
+                                           EPD_WIDTH - 2 * TEXT_MARGIN, 0x00,
+                                           BLACK_ON_WHITE, &shown_table);
+    ESP_LOGI(TAG, "Table update: %s", update == TEXT_TABLE_REDRAWN ? "full"
+                                      : update == TEXT_TABLE_PARTIAL ? "changed rows" : "none");
+
+    epd_poweroff();
+}
+
+
+static void save_snapshot(const msg_buffer_t *msg) {
+    if (!mount_snapshot()) {
+        return;
+    }
+    if (msg->type != DISPLAY_TABLE) {
+        snapshot_save(SNAPSHOT_PATH, DISPLAY_TEXT, shown_text, msg->data, msg->length);
+        return;
+    }
+
+    // the fingerprint goes first, a partial update after reset needs its row hashes.
+    const TextTable *table = &((const TableContent *)msg->data)->table;
+    uint32_t size = sizeof(TableFingerprint) + text_table_pack(table, NULL, 0);
+    uint8_t *data = arena_scratch_alloc(size);
+    if (!data) {
+        return;
+    }
+    memcpy(data, &shown_table, sizeof(TableFingerprint));
+    text_table_pack(table, data + sizeof(TableFingerprint), size - sizeof(TableFingerprint));
+    snapshot_save(SNAPSHOT_PATH, DISPLAY_TABLE, shown_table.content, data, size);
+    arena_scratch_free(data);
+}
+
+
+static msg_buffer_t *load_snapshot(uint64_t *text_hash, TableFingerprint *table_fingerprint) {
+    snapshot_header_t header;
+    if (snapshot_info(SNAPSHOT_PATH, &header) != ESP_OK) {
+        return NULL;
+    }
+    *text_hash = 0;
+    memset(table_fingerprint, 0, sizeof(TableFingerprint));
+
+    if (header.type == DISPLAY_TEXT) {
+        msg_buffer_t *msg = msg_pool_alloc(DISPLAY_TEXT, header.length);
+        if (!msg) {
+            return NULL;
+        }
+        if (snapshot_load(SNAPSHOT_PATH, &header, msg->data, msg->capacity) != ESP_OK ||
+            header.length == 0 || msg->data[header.length - 1] != '\0') {
+            msg_pool_release(msg);
+            return NULL;
+        }
+        msg->length = header.length;
+        *text_hash = header.hash;
+        return msg;
+    }
+
+    if (header.type != DISPLAY_TABLE || header.length < sizeof(TableFingerprint)) {
+        return NULL;
+    }
+    uint8_t *data = arena_scratch_alloc(header.length);
+    msg_buffer_t *msg = msg_pool_alloc(DISPLAY_TABLE, sizeof(TableContent));
+    bool loaded = data && msg && snapshot_load(SNAPSHOT_PATH, &header, data, header.length) == ESP_OK;
+    if (loaded) {
+        TableContent *content = (TableContent *)msg->data;
+        text_table_init(&content->table, content->cells, MAX_TABLE_CELLS, content->text, sizeof(content->text));
+        loaded = text_table_unpack(&content->table, data + sizeof(TableFingerprint),
+                                   header.length - sizeof(TableFingerprint));
+        memcpy(table_fingerprint, data, sizeof(TableFingerprint));
+        msg->length = sizeof(TableContent);
+    }
+    arena_scratch_free(data);
+    if (!loaded) {
+        memset(table_fingerprint, 0, sizeof(TableFingerprint));
+        msg_pool_release(msg);
+        return NULL;
+    }
+    return msg;
+}
+
+
+static void restore_snapshot(void) {
+    // after deep sleep the RTC memory still knows what the panel shows.
+    if (shown_text != 0 || shown_table.content != 0) {
+        return;
+    }
+    if (!mount_snapshot()) {
+        return;
+    }
+
+    uint64_t text_hash;
+    TableFingerprint fingerprint;
+    msg_buffer_t *msg = load_snapshot(&text_hash, &fingerprint);
+    if (!msg) {
+        return;
+    }
+
+    esp_reset_reason_t reason = esp_reset_reason();
+    if (reason == ESP_RST_BROWNOUT || reason == ESP_RST_PANIC || reason == ESP_RST_INT_WDT ||
+        reason == ESP_RST_TASK_WDT || reason == ESP_RST_WDT) {
+        // a refresh may have been cut short, the panel is cleared and redrawn from the snapshot.
+        ESP_LOGI(TAG, "Redrawing the display from the snapshot");
+        post_display(msg);
+        return;
+    }
+
+    // the panel kept the image, new content is drawn as changes to it.
+    ESP_LOGI(TAG, "Display content restored from the snapshot");
+    shown_text = text_hash;
+    shown_table = fingerprint;
+    msg_pool_release(msg);
+}
+
+
+void display_task(void *pvParameter) {
+    u_int32_t buffer_size = sizeof(uint8_t) * EPD_WIDTH * EPD_HEIGHT / 2 ;
+    printf("Buffer size: %ld", buffer_size);
+    framebuffer = (uint8_t *)heap_caps_calloc(1, buffer_size, MALLOC_CAP_SPIRAM);
+    if (!framebuffer) {
+        printf("Failed to allocate framebuffer");
+        return;
+    }
+    // clear on the DMA engine, the CPU is free for the EPD setup meanwhile.
+    epd_fb_dma_fill(framebuffer, 0xFF, buffer_size, NULL, NULL);
+    printf("Initialize EPD");
+
+    // the drawing buffers come from the arena, without it from the heap.
+    if (arena_init(&render_arena, RENDER_ARENA_SIZE) == ESP_OK) {
+        arena_scratch_bind(&render_arena);
+    } else {
+        ESP_LOGW(TAG, "No memory for the render arena");
+    }
+
+    msg_pool_stats_t stats;
+    msg_pool_get_stats(&stats);
+    uint32_t coalesced = stats.coalesced;
+
+    while (1) {
+        // updates that arrived meanwhile are coalesced, only the newest is drawn.
+        msg_buffer_t *msg = msg_pool_receive_latest(displayQueue, portMAX_DELAY);
+        if (!msg) {
+            continue;
+        }
+        if (!content_changed(msg)) {
+            // the panel shows this already, a refresh would only flash it.
+            ESP_LOGI(TAG, "Content unchanged, display not refreshed");
+            msg_pool_release(msg);
+        } else {
+            epd_fb_dma_wait();
+            ESP_LOGI(TAG, "Updating display with received text...");
+            printf("Received message\n");
+            epd_init();
+
+            epd_poweron();
+
+            // the content is drawn in place, the buffer goes back to the pool after.
+            if (msg->type == DISPLAY_TABLE) {
+                draw_table(&((TableContent *)msg->data)->table);
+            } else {
+                draw_text((const char *)msg->data);
+            }
+            save_snapshot(msg);
+            msg_pool_release(msg);
+            display_changes++;
+
+            ESP_LOGD(TAG, "Render arena: %u bytes at peak, %" PRIu32 " heap fallbacks",
+                     (unsigned)render_arena.peak, render_arena.fallbacks);
+            arena_reset(&render_arena);
+        }
+
+        // the main task sleeps once everything it posted is on the panel.
+        msg_pool_get_stats(&stats);
+        display_handled += 1 + stats.coalesced - coalesced;
+        coalesced = stats.coalesced;
+        xSemaphoreGive(displayUpdateSemaphore);
+    }
+}
+
+
+static void post_display(msg_buffer_t *msg) {
+    if (!display_task_handle) {
+        xTaskCreate(&display_task, "display_task", 32000, NULL, 5, &display_task_handle);
+    }
+    display_posted++;
+    if (msg_pool_send(displayQueue, msg, portMAX_DELAY) != pdTRUE) {
+        display_posted--;
+    }
+}
+
+
+static bool wait_display(uint32_t timeout_ms) {
+    TickType_t start = xTaskGetTickCount();
+    while (display_handled != display_posted) {
+        TickType_t waited = xTaskGetTickCount() - start;
+        if (waited >= pdMS_TO_TICKS(timeout_ms) ||
+            xSemaphoreTake(displayUpdateSemaphore, pdMS_TO_TICKS(timeout_ms) - waited) != pdTRUE) {
+            return display_handled == display_posted;
+        }
+    }
+    return true;
+}
+
+// The assignments table of the parents' page.
+#define TABLE_MATCH "cellpadding=\"2\" cellspacing=\"0\" class=\"ON\" style=\"width: 550px;\""
+#define CAPTION_MATCH "Seznam zadan"
+
+// The table is parsed while it downloads, only its cells are kept.
+static html_table_parser_t table_parser;
+
+// The table being parsed, NULL if there was no memory for it.
+static msg_buffer_t *table_msg = NULL;
+
+static void add_table_text(html_table_event_t event, const char *text, uint32_t length) {
+    // the page is ISO-8859-2, the font wants UTF-8, two bytes at most per character.
+    // entities are decoded in the same pass, none is longer in UTF-8 than in the page.
+    char utf8_text[2 * HTML_TABLE_TEXT_MAX + 1];
+    size_t consumed;
+    size_t utf8_length = html_entity_to_utf8(text, length, &consumed, utf8_text, sizeof(utf8_text) - 1,
+                                             iso8859_2_code_point, HTML_ENTITY_NBSP_SPACE);
+    utf8_text[utf8_length] = '\0';
+
+    TextTable *table = &((TableContent *)table_msg->data)->table;
+    bool added = event == HTML_TABLE_CAPTION
+        ? text_table_set_caption(table, utf8_text, strlen(utf8_text))
+        : text_table_add_cell(table, utf8_text, strlen(utf8_text));
+    if (!added) {
+        ESP_LOGW(TAG, "table storage full, dropped: %s", utf8_text);
+    }
+}
+
+
+static void send_display_message(const char *text) {
+    if (strlen(text) == 0) {
+        text = "No data found";
+    }
+
+    // the text is copied once into a buffer of its size, the display task reads it there.
+    size_t length = strlen(text) + 1;
+    msg_buffer_t *msg = msg_pool_alloc(DISPLAY_TEXT, length);
+    if (!msg) {
+        ESP_LOGE(TAG, "no memory for a display message");
+        return;
+    }
+    memcpy(msg->data, text, length);
+    msg->length = length;
+    post_display(msg);
+}
+
+
+static void table_event(html_table_event_t event, const char *text, uint32_t length, void *arg) {
+    if (!table_msg) {
+        return;
+    }
+
+    switch (event) {
+    case HTML_TABLE_CAPTION:
+    case HTML_TABLE_CELL:
+        add_table_text(event, text, length);
+        break;
+    case HTML_TABLE_ROW_END:
+        text_table_end_row(&((TableContent *)table_msg->data)->table);
+        break;
+    case HTML_TABLE_END: {
+        // the rest of the page is not needed.
+        ESP_LOGI(TAG, "Parsed table: %u rows", ((TableContent *)table_msg->data)->table.row_count);
+        table_msg->length = sizeof(TableContent);
+        post_display(table_msg);
+        // the table belongs to the display task now, the next page gets a new one.
+        table_msg = NULL;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+
+static void reset_table_parser(void) {
+    if (!table_msg) {
+        table_msg = msg_pool_alloc(DISPLAY_TABLE, sizeof(TableContent));
+        if (!table_msg) {
+            ESP_LOGE(TAG, "no memory for a table");
+        }
+    }
+    if (table_msg) {
+        TableContent *content = (TableContent *)table_msg->data;
+        text_table_init(&content->table, content->cells, MAX_TABLE_CELLS, content->text, sizeof(content->text));
+    }
+    html_table_parser_init(&table_parser, TABLE_MATCH, CAPTION_MATCH, table_event, NULL);
+}
+
+
+// The parents' page, behind the login form of the school system.
+#define PAGE_URL "https://aes.zskaminky.cz/rodic/index.php?l=cs"
+#define LOGIN_URL "https://aes.zskaminky.cz/auth/?u=https%3A%2F%2Faes.zskaminky.cz%2Frodic%2Findex.php%3Fl%3Dcs&a=3&l=cs"
+#define USER_AGENT "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/121.0.0.0 Safari/537.36"
+
+// The session and the page validators survive deep sleep, a poll then needs no login.
+RTC_DATA_ATTR static fetch_session_t fetch_session;
+static fetch_t fetcher;
+static char login_body[128];
+
+static bool page_body(fetch_body_event_t event, const char *data, size_t length, void *arg) {
+    switch (event) {
+    case FETCH_BODY_BEGIN:
+        reset_table_parser();
+        break;
+    case FETCH_BODY_DATA:
+        // each chunk is parsed as it arrives, nothing of the page is buffered.
+        html_table_parser_feed(&table_parser, data, length);
+        break;
+    case FETCH_BODY_END:
+        // without the table the page is most likely the login form.
+        return html_table_parser_found(&table_parser);
+    }
+    return true;
+}
+
+
+static esp_err_t init_fetcher(void) {
+    snprintf(login_body, sizeof(login_body), "username=%s&pwd=%s&submit=", UserLogin, UserPassword);
+    fetch_config_t config = {
+        .page_url = PAGE_URL,
+        .login_url = LOGIN_URL,
+        .login_body = login_body,
+        .cookie_name = "PHPSESSID",
+        .cert_pem = GeorgikPem,
+        .user_agent = USER_AGENT,
+        .on_body = page_body,
+        .timeout_ms = 10000,
+        .attempts = 4,
+        .backoff_ms = 2000,
+        .backoff_max_ms = 30000,
+    };
+    return fetch_init(&fetcher, &config, &fetch_session);
+}
+
+
+static poll_outcome_t poll_page(void) {
+    fetch_result_t result;
+    esp_err_t err = fetch_poll(&fetcher, &result);
+    if (err == ESP_ERR_NOT_FOUND) {
+        send_display_message("Table not found");
+        return POLL_FAILED;
+    } else if (err != ESP_OK) {
+        // the panel keeps the last content, the next poll tries again.
+        ESP_LOGW(TAG, "Fetching the page failed: %s", esp_err_to_name(err));
+        return POLL_FAILED;
+    } else if (result == FETCH_NOT_MODIFIED) {
+        ESP_LOGI(TAG, "Page not modified");
+        return POLL_UNCHANGED;
+    }
+    return POLL_CHANGED;
+}
+
+
+// Polls are spaced out while the page does not change, the device sleeps in between.
+#define POLL_INTERVAL_MS (15 * 60 * 1000)
+#define POLL_MAX_INTERVAL_MS (2 * 60 * 60 * 1000)
+#define WIFI_TIMEOUT_MS 30000
+#define RENDER_TIMEOUT_MS 60000
+
+static const poll_schedule_config_t schedule_config = {
+    .interval_ms = POLL_INTERVAL_MS,
+    .max_interval_ms = POLL_MAX_INTERVAL_MS,
+    .stretch_after = 4,
+    .min_sleep_ms = 5000,
+};
+RTC_DATA_ATTR static poll_schedule_t schedule;
+
+// The RTC clock keeps running in deep sleep, it restarts at 0 on power on.
+static uint64_t clock_ms(void) {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+
+static void enter_sleep(uint32_t sleep_ms) {
+    poll_schedule_seal(&schedule);
+    ESP_LOGI(TAG, "Sleeping %" PRIu32 " s, poll %" PRIu32 ", interval %" PRIu32 " s",
+             sleep_ms / 1000, schedule.polls, schedule.interval_ms / 1000);
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_ms * 1000);
+    esp_deep_sleep_start();
+}
+
+
+static void event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data) {
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+        ESP_LOGI(TAG, "WiFi connect initiated...");
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        esp_wifi_connect();
+        ESP_LOGI(TAG, "Disconnected. Attempting to reconnect...");
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+
+        // the main task polls the page once connected
+        xSemaphoreGive(downloadSemaphore);
+    }
+}
+
+
+
+void wifi_init_sta(void) {
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    ESP_ERROR_CHECK(esp_netif_init()); // Initializes the TCP/IP stack
+
+    // Note: The esp_event_loop_create_default() call has been removed from here.
+
+    esp_netif_create_default_wifi_sta();
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &event_handler, NULL, NULL));
+
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = WIFI_SSID,
+            .password = WIFI_PASS,
+        },
+    };
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    ESP_ERROR_CHECK(esp_wifi_start());
+
+    // ESP_LOGI(TAG, "wifi_init_sta finished.");
+    // ESP_LOGI(TAG, "connect to ap SSID:%s password:%s", WIFI_SSID, "******");
+}
+
+
+void app_main(void) {
+    esp_log_level_set("*", ESP_LOG_VERBOSE);
+
+    // the schedule survives deep sleep, a wake before the poll is due goes back to sleep.
+    uint32_t sleep_ms;
+    if (!poll_schedule_valid(&schedule)) {
+        poll_schedule_init(&schedule, &schedule_config, clock_ms());
+    }
+    if (poll_schedule_next(&schedule, &schedule_config, clock_ms(), &sleep_ms) == POLL_ACTION_SLEEP) {
+        enter_sleep(sleep_ms);
+    }
+
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+
+    // Initialize the semaphores
+    downloadSemaphore = xSemaphoreCreateBinary();
+    displayUpdateSemaphore = xSemaphoreCreateBinary();
+    displayQueue = xQueueCreate(DISPLAY_QUEUE_LENGTH, sizeof(msg_buffer_t *));
+         // Check for successful semaphore creation
+    if (downloadSemaphore == NULL || displayUpdateSemaphore == NULL) {
+        ESP_LOGE(TAG, "Failed to create semaphores");
+        // Handle semaphore creation failure (e.g., reset or halt)
+    }
+    reset_table_parser();
+    restore_snapshot();
+    ESP_ERROR_CHECK(init_fetcher());
+
+    wifi_init_sta();
+
+    poll_outcome_t outcome = POLL_FAILED;
+    uint32_t changes = display_changes;
+    if (xSemaphoreTake(downloadSemaphore, pdMS_TO_TICKS(WIFI_TIMEOUT_MS)) == pdTRUE) {
+        ESP_LOGI(TAG, "Semaphore given. Initiating download...");
+        outcome = poll_page();
+    } else {
+        ESP_LOGW(TAG, "No WiFi connection");
+    }
+    uint32_t retry_ms = outcome == POLL_FAILED ? fetch_retry_delay_ms(&fetcher, POLL_INTERVAL_MS) : 0;
+    fetch_deinit(&fetcher);
+    esp_wifi_stop();
+
+    // the panel keeps its image without power, only a finished refresh may be cut off.
+    if (!wait_display(RENDER_TIMEOUT_MS)) {
+        ESP_LOGW(TAG, "Display update not finished");
+    }
+    if (display_task_handle) {
+        epd_poweroff_all();
+    }
+
+    // a page served again with the same content counts as unchanged.
+    if (outcome == POLL_CHANGED && display_changes == changes) {
+        outcome = POLL_UNCHANGED;
+    }
+    poll_schedule_update(&schedule, &schedule_config, clock_ms(), outcome, retry_ms);
+    enter_sleep(poll_schedule_remaining_ms(&schedule, clock_ms()));
+}
@@ -0,0 +1,440 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "fetch.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <esp_log.h>
+#include <esp_random.h>
+#include <esp_timer.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define HTTP_OK 200
+#define HTTP_NOT_MODIFIED 304
+#define HTTP_UNAUTHORIZED 401
+#define HTTP_FORBIDDEN 403
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static esp_err_t http_event(esp_http_client_event_t *evt);
+
+/**
+ * @brief Keep the session cookie of a Set-Cookie header.
+ */
+static void take_cookie(fetch_t *fetch, const char *value);
+
+/**
+ * @brief Get a session cookie and post the credentials with it.
+ */
+static esp_err_t login(fetch_t *fetch);
+
+/**
+ * @brief Request the page, conditionally if it was fetched before.
+ *
+ * @param rejected Set if the response shows that the session is not valid.
+ */
+static esp_err_t request_page(fetch_t *fetch, int *status, bool *rejected);
+
+/**
+ * @brief Set a request header, or remove it if the value is empty.
+ */
+static void set_header(esp_http_client_handle_t client, const char *key,
+                       const char *value);
+
+static void forget_session(fetch_session_t *session);
+
+/**
+ * @brief Wait before a retry, half of the delay is random.
+ */
+static void backoff(uint32_t delay_ms);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "fetch";
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+esp_err_t fetch_init(fetch_t *fetch, const fetch_config_t *config,
+                     fetch_session_t *session)
+{
+    memset(fetch, 0, sizeof(fetch_t));
+    fetch->config = *config;
+    fetch->session = session;
+    if (fetch->config.attempts == 0)
+    {
+        fetch->config.attempts = 1;
+    }
+
+    // redirects are not followed, a redirect of the page means a login.
+    esp_http_client_config_t client_config = {
+        .url = config->page_url,
+        .cert_pem = config->cert_pem,
+        .user_agent = config->user_agent,
+        .timeout_ms = config->timeout_ms,
+        .disable_auto_redirect = true,
+        .keep_alive_enable = true,
+        .event_handler = http_event,
+        .user_data = fetch,
+    };
+    fetch->client = esp_http_client_init(&client_config);
+    if (fetch->client == NULL)
+    {
+        ESP_LOGE(TAG, "cannot create the HTTP client");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t fetch_poll(fetch_t *fetch, fetch_result_t *result)
+{
+    fetch_session_t *session = fetch->session;
+    int64_t start = esp_timer_get_time();
+    uint32_t requests = fetch->stats.requests;
+    fetch->stats.polls++;
+
+    esp_err_t err = ESP_FAIL;
+    bool logged_in = false;
+    bool retry_now = false;
+    uint32_t delay_ms = fetch->config.backoff_ms;
+    for (uint32_t attempt = 0; attempt < fetch->config.attempts;)
+    {
+        if (attempt > 0 && !retry_now)
+        {
+            fetch->stats.retries++;
+            backoff(delay_ms);
+            delay_ms = delay_ms * 2 < fetch->config.backoff_max_ms
+                           ? delay_ms * 2
+                           : fetch->config.backoff_max_ms;
+        }
+        retry_now = false;
+
+        if (session->cookie[0] == '\0')
+        {
+            err = login(fetch);
+            if (err != ESP_OK)
+            {
+                attempt++;
+                continue;
+            }
+            logged_in = true;
+        }
+
+        int status = 0;
+        bool rejected = false;
+        err = request_page(fetch, &status, &rejected);
+        if (err == ESP_OK && rejected)
+        {
+            forget_session(session);
+            if (logged_in)
+            {
+                // a fresh session is rejected as well, retries do not help.
+                ESP_LOGE(TAG, "page rejected after login");
+                err = ESP_ERR_NOT_FOUND;
+                break;
+            }
+            // the session expired, log in again without counting an attempt.
+            ESP_LOGI(TAG, "session rejected, logging in");
+            retry_now = true;
+            continue;
+        }
+        if (err == ESP_OK && status == HTTP_NOT_MODIFIED)
+        {
+            fetch->stats.not_modified++;
+            *result = FETCH_NOT_MODIFIED;
+            break;
+        }
+        if (err == ESP_OK && status == HTTP_OK)
+        {
+            *result = FETCH_CHANGED;
+            break;
+        }
+        if (err == ESP_OK)
+        {
+            ESP_LOGW(TAG, "page status %d", status);
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+        else
+        {
+            ESP_LOGW(TAG, "page request failed: %s", esp_err_to_name(err));
+        }
+        attempt++;
+    }
+
+    session->failures = err == ESP_OK ? 0 : session->failures + 1;
+    fetch->stats.last_requests = fetch->stats.requests - requests;
+    fetch->stats.last_poll_us = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "poll: %" PRIu32 " requests in %" PRId64 " ms",
+             fetch->stats.last_requests, fetch->stats.last_poll_us / 1000);
+    return err;
+}
+
+
+uint32_t fetch_retry_delay_ms(const fetch_t *fetch, uint32_t interval_ms)
+{
+    uint32_t failures = fetch->session->failures;
+    if (failures == 0)
+    {
+        return 0;
+    }
+
+    uint64_t delay_ms = fetch->config.backoff_ms;
+    for (uint32_t i = 1; i < failures && delay_ms < interval_ms; i++)
+    {
+        delay_ms *= 2;
+    }
+    return delay_ms < interval_ms ? (uint32_t)delay_ms : interval_ms;
+}
+
+
+void fetch_get_stats(const fetch_t *fetch, fetch_stats_t *stats)
+{
+    *stats = fetch->stats;
+}
+
+
+void fetch_deinit(fetch_t *fetch)
+{
+    if (fetch->client != NULL)
+    {
+        esp_http_client_cleanup(fetch->client);
+        fetch->client = NULL;
+    }
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static esp_err_t http_event(esp_http_client_event_t *evt)
+{
+    fetch_t *fetch = (fetch_t *)evt->user_data;
+    switch (evt->event_id)
+    {
+    case HTTP_EVENT_ON_HEADER:
+        if (strcasecmp(evt->header_key, "Set-Cookie") == 0)
+        {
+            take_cookie(fetch, evt->header_value);
+        }
+        else if (strcasecmp(evt->header_key, "ETag") == 0)
+        {
+            snprintf(fetch->etag, sizeof(fetch->etag), "%s", evt->header_value);
+        }
+        else if (strcasecmp(evt->header_key, "Last-Modified") == 0)
+        {
+            snprintf(fetch->last_modified, sizeof(fetch->last_modified), "%s",
+                     evt->header_value);
+        }
+        break;
+    case HTTP_EVENT_ON_DATA:
+        // only a page is passed on, login responses and errors are dropped.
+        if (fetch->in_page &&
+            esp_http_client_get_status_code(evt->client) == HTTP_OK)
+        {
+            if (!fetch->body_started)
+            {
+                fetch->body_started = true;
+                fetch->config.on_body(FETCH_BODY_BEGIN, NULL, 0,
+                                      fetch->config.arg);
+            }
+            fetch->config.on_body(FETCH_BODY_DATA, (const char *)evt->data,
+                                  evt->data_len, fetch->config.arg);
+        }
+        break;
+    default:
+        break;
+    }
+    return ESP_OK;
+}
+
+
+static void take_cookie(fetch_t *fetch, const char *value)
+{
+    const char *name = fetch->config.cookie_name;
+    size_t name_length = strlen(name);
+    if (strncmp(value, name, name_length) != 0 || value[name_length] != '=')
+    {
+        return;
+    }
+
+    size_t length = strcspn(value, ";");
+    const char *cookie_value = value + name_length + 1;
+    if (cookie_value == value + length || strncmp(cookie_value, "deleted", 7) == 0)
+    {
+        // the site ended the session.
+        fetch->session->cookie[0] = '\0';
+        return;
+    }
+    if (length >= sizeof(fetch->session->cookie))
+    {
+        ESP_LOGW(TAG, "session cookie too long, not kept");
+        return;
+    }
+    memcpy(fetch->session->cookie, value, length);
+    fetch->session->cookie[length] = '\0';
+}
+
+
+static esp_err_t login(fetch_t *fetch)
+{
+    esp_http_client_handle_t client = fetch->client;
+    fetch_session_t *session = fetch->session;
+
+    // the login form expects the session cookie it sets itself.
+    esp_http_client_set_url(client, fetch->config.login_url);
+    esp_http_client_set_method(client, HTTP_METHOD_GET);
+    esp_http_client_set_post_field(client, NULL, 0);
+    set_header(client, "Cookie", NULL);
+    set_header(client, "Content-Type", NULL);
+    set_header(client, "If-None-Match", NULL);
+    set_header(client, "If-Modified-Since", NULL);
+    esp_err_t err = esp_http_client_perform(client);
+    fetch->stats.requests++;
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "login form request failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (session->cookie[0] == '\0')
+    {
+        ESP_LOGE(TAG, "no %s cookie from the login form",
+                 fetch->config.cookie_name);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    esp_http_client_set_method(client, HTTP_METHOD_POST);
+    set_header(client, "Cookie", session->cookie);
+    set_header(client, "Content-Type", "application/x-www-form-urlencoded");
+    esp_http_client_set_post_field(client, fetch->config.login_body,
+                                   strlen(fetch->config.login_body));
+    err = esp_http_client_perform(client);
+    fetch->stats.requests++;
+    fetch->stats.logins++;
+    esp_http_client_set_post_field(client, NULL, 0);
+    set_header(client, "Content-Type", NULL);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "login failed: %s", esp_err_to_name(err));
+        forget_session(session);
+        return err;
+    }
+
+    int status = esp_http_client_get_status_code(client);
+    if (status >= 400 || session->cookie[0] == '\0')
+    {
+        ESP_LOGE(TAG, "login rejected, status %d", status);
+        forget_session(session);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    // the validators of another session's page are not trusted.
+    session->etag[0] = '\0';
+    session->last_modified[0] = '\0';
+    return ESP_OK;
+}
+
+
+static esp_err_t request_page(fetch_t *fetch, int *status, bool *rejected)
+{
+    esp_http_client_handle_t client = fetch->client;
+    fetch_session_t *session = fetch->session;
+
+    esp_http_client_set_url(client, fetch->config.page_url);
+    esp_http_client_set_method(client, HTTP_METHOD_GET);
+    set_header(client, "Cookie", session->cookie);
+    set_header(client, "If-None-Match", session->etag);
+    set_header(client, "If-Modified-Since", session->last_modified);
+
+    fetch->etag[0] = '\0';
+    fetch->last_modified[0] = '\0';
+    fetch->in_page = true;
+    fetch->body_started = false;
+    esp_err_t err = esp_http_client_perform(client);
+    fetch->in_page = false;
+    fetch->stats.requests++;
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    *status = esp_http_client_get_status_code(client);
+    *rejected = *status == HTTP_UNAUTHORIZED || *status == HTTP_FORBIDDEN ||
+                (*status >= 300 && *status < 400 &&
+                 *status != HTTP_NOT_MODIFIED);
+    if (*status == HTTP_OK)
+    {
+        if (!fetch->body_started)
+        {
+            fetch->config.on_body(FETCH_BODY_BEGIN, NULL, 0, fetch->config.arg);
+        }
+        *rejected = !fetch->config.on_body(FETCH_BODY_END, NULL, 0,
+                                           fetch->config.arg);
+    }
+
+    // validators are kept for a complete, accepted page only.
+    if (*status == HTTP_OK && !*rejected)
+    {
+        snprintf(session->etag, sizeof(session->etag), "%s", fetch->etag);
+        snprintf(session->last_modified, sizeof(session->last_modified), "%s",
+                 fetch->last_modified);
+    }
+    return ESP_OK;
+}
+
+
+static void set_header(esp_http_client_handle_t client, const char *key,
+                       const char *value)
+{
+    if (value != NULL && value[0] != '\0')
+    {
+        esp_http_client_set_header(client, key, value);
+    }
+    else
+    {
+        esp_http_client_delete_header(client, key);
+    }
+}
+
+
+static void forget_session(fetch_session_t *session)
+{
+    session->cookie[0] = '\0';
+    session->etag[0] = '\0';
+    session->last_modified[0] = '\0';
+}
+
+
+static void backoff(uint32_t delay_ms)
+{
+    uint32_t half = delay_ms / 2;
+    uint32_t wait_ms = half + (half > 0 ? esp_random() % (half + 1) : 0);
+    vTaskDelay(pdMS_TO_TICKS(wait_ms));
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
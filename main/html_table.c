@@ -0,0 +1,353 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "html_table.h"
+
+#include <ctype.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Returns true if the tag name at `name` is `expected`, ignoring case.
+ */
+static bool tag_is(const char *name, const char *expected);
+
+static void append_text(html_table_parser_t *parser, char c);
+
+static void emit(html_table_parser_t *parser, html_table_event_t event,
+                 const char *text, uint32_t length);
+
+static void close_cell(html_table_parser_t *parser);
+
+static void close_row(html_table_parser_t *parser);
+
+/**
+ * @brief Update the table structure by a complete tag.
+ */
+static void handle_tag(html_table_parser_t *parser);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void html_table_parser_init(html_table_parser_t *parser,
+                            const char *table_match,
+                            const char *caption_match,
+                            html_table_callback_t callback, void *arg)
+{
+    memset(parser, 0, sizeof(html_table_parser_t));
+    parser->table_match = table_match;
+    parser->caption_match = caption_match;
+    parser->callback = callback;
+    parser->arg = arg;
+    parser->state = HTML_TABLE_STATE_TEXT;
+}
+
+
+void html_table_parser_feed(html_table_parser_t *parser, const char *data,
+                            size_t length)
+{
+    const char *end = data + length;
+    while (data < end && !parser->done)
+    {
+        char c = *data++;
+        switch (parser->state)
+        {
+        case HTML_TABLE_STATE_TEXT:
+            if (c == '<')
+            {
+                parser->state = HTML_TABLE_STATE_TAG;
+                parser->tag_length = 0;
+                parser->quote = 0;
+            }
+            else if (parser->in_cell || parser->in_caption)
+            {
+                append_text(parser, c);
+            }
+            else
+            {
+                // text outside of cells is not needed, skip to the next tag.
+                const char *tag = memchr(data, '<', end - data);
+                data = tag != NULL ? tag : end;
+            }
+            break;
+
+        case HTML_TABLE_STATE_TAG:
+            if (parser->tag_length == 0 && !isalpha((unsigned char)c) &&
+                c != '/' && c != '!')
+            {
+                // a lone '<' is text.
+                parser->state = HTML_TABLE_STATE_TEXT;
+                if (parser->in_cell || parser->in_caption)
+                {
+                    append_text(parser, '<');
+                }
+                data--;
+                break;
+            }
+            if (parser->quote != 0)
+            {
+                parser->quote = c == parser->quote ? 0 : parser->quote;
+            }
+            else if ((c == '"' || c == '\'') && parser->tag_length > 0 &&
+                     parser->tag[parser->tag_length - 1] == '=')
+            {
+                parser->quote = c;
+            }
+            else if (c == '>')
+            {
+                parser->tag[parser->tag_length] = '\0';
+                parser->state = HTML_TABLE_STATE_TEXT;
+                handle_tag(parser);
+                break;
+            }
+
+            if (parser->tag_length < HTML_TABLE_TAG_MAX - 1)
+            {
+                parser->tag[parser->tag_length++] = c;
+            }
+            if (parser->tag_length == 3 && memcmp(parser->tag, "!--", 3) == 0)
+            {
+                parser->state = HTML_TABLE_STATE_COMMENT;
+                parser->comment_dashes = 0;
+            }
+            break;
+
+        case HTML_TABLE_STATE_COMMENT:
+            if (c == '>' && parser->comment_dashes >= 2)
+            {
+                parser->state = HTML_TABLE_STATE_TEXT;
+            }
+            parser->comment_dashes = c == '-' ? parser->comment_dashes + 1 : 0;
+            break;
+
+        case HTML_TABLE_STATE_RAW:
+            // markup is not parsed before the end tag, a '<' may be script.
+            if (tolower((unsigned char)c) == parser->raw_end[parser->raw_matched])
+            {
+                parser->raw_matched++;
+            }
+            else
+            {
+                parser->raw_matched = c == '<';
+            }
+            if (parser->raw_end[parser->raw_matched] == '\0')
+            {
+                parser->state = HTML_TABLE_STATE_TAG;
+                parser->tag_length = parser->raw_matched - 1;
+                memcpy(parser->tag, parser->raw_end + 1, parser->tag_length);
+                parser->quote = 0;
+            }
+            break;
+        }
+    }
+}
+
+
+bool html_table_parser_found(const html_table_parser_t *parser)
+{
+    return parser->matched;
+}
+
+
+bool html_table_parser_done(const html_table_parser_t *parser)
+{
+    return parser->done;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static bool tag_is(const char *name, const char *expected)
+{
+    while (*expected != '\0')
+    {
+        if (tolower((unsigned char)*name++) != *expected++)
+        {
+            return false;
+        }
+    }
+    return *name == '\0' || *name == '/' || isspace((unsigned char)*name);
+}
+
+
+static void append_text(html_table_parser_t *parser, char c)
+{
+    if (isspace((unsigned char)c))
+    {
+        parser->space = parser->text_length > 0;
+        return;
+    }
+
+    // keep room for the terminating NUL of caption matching.
+    if (parser->space && parser->text_length < HTML_TABLE_TEXT_MAX - 1)
+    {
+        parser->text[parser->text_length++] = ' ';
+    }
+    parser->space = false;
+    if (parser->text_length < HTML_TABLE_TEXT_MAX - 1)
+    {
+        parser->text[parser->text_length++] = c;
+    }
+}
+
+
+static void emit(html_table_parser_t *parser, html_table_event_t event,
+                 const char *text, uint32_t length)
+{
+    if (parser->matched && parser->callback != NULL)
+    {
+        parser->callback(event, text, length, parser->arg);
+    }
+}
+
+
+static void close_cell(html_table_parser_t *parser)
+{
+    if (parser->in_cell)
+    {
+        parser->in_cell = false;
+        emit(parser, HTML_TABLE_CELL, parser->text, parser->text_length);
+    }
+}
+
+
+static void close_row(html_table_parser_t *parser)
+{
+    close_cell(parser);
+    if (parser->in_row)
+    {
+        parser->in_row = false;
+        emit(parser, HTML_TABLE_ROW_END, NULL, 0);
+    }
+}
+
+
+static void handle_tag(html_table_parser_t *parser)
+{
+    bool end = parser->tag[0] == '/';
+    const char *name = parser->tag + end;
+
+    if (!end && (tag_is(name, "script") || tag_is(name, "style")))
+    {
+        parser->state = HTML_TABLE_STATE_RAW;
+        parser->raw_end = tag_is(name, "script") ? "</script" : "</style";
+        parser->raw_matched = 0;
+        return;
+    }
+
+    if (!parser->in_table)
+    {
+        if (!end && tag_is(name, "table") &&
+            (parser->table_match == NULL || strstr(name, parser->table_match) != NULL))
+        {
+            parser->in_table = true;
+            parser->nesting = 0;
+            parser->matched = parser->caption_match == NULL;
+        }
+        return;
+    }
+
+    if (tag_is(name, "table"))
+    {
+        if (!end)
+        {
+            parser->nesting++;
+        }
+        else if (parser->nesting > 0)
+        {
+            parser->nesting--;
+        }
+        else
+        {
+            close_row(parser);
+            parser->in_table = false;
+            parser->in_caption = false;
+            if (parser->matched)
+            {
+                emit(parser, HTML_TABLE_END, NULL, 0);
+                parser->done = true;
+            }
+        }
+        return;
+    }
+
+    // nested tables are flattened into the text of the outer cell.
+    if (parser->nesting > 0)
+    {
+        parser->space = parser->text_length > 0;
+        return;
+    }
+
+    if (tag_is(name, "caption"))
+    {
+        if (!end)
+        {
+            parser->in_caption = true;
+            parser->text_length = 0;
+            parser->space = false;
+        }
+        else if (parser->in_caption)
+        {
+            parser->in_caption = false;
+            parser->text[parser->text_length] = '\0';
+            if (parser->caption_match != NULL &&
+                strstr(parser->text, parser->caption_match) == NULL)
+            {
+                // not the wanted table, look at the next one.
+                parser->in_table = false;
+                return;
+            }
+            parser->matched = true;
+            emit(parser, HTML_TABLE_CAPTION, parser->text, parser->text_length);
+        }
+        return;
+    }
+
+    if (tag_is(name, "tr"))
+    {
+        close_row(parser);
+        parser->in_row = !end;
+    }
+    else if (tag_is(name, "td") || tag_is(name, "th"))
+    {
+        close_cell(parser);
+        if (!end)
+        {
+            parser->in_row = true;
+            parser->in_cell = true;
+            parser->text_length = 0;
+            parser->space = false;
+        }
+    }
+    else if (tag_is(name, "br") || tag_is(name, "p") || tag_is(name, "div") ||
+             tag_is(name, "li"))
+    {
+        parser->space = parser->text_length > 0;
+    }
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
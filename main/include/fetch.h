@@ -0,0 +1,196 @@
+/**
+ * Polling of a page behind a login form.
+ *
+ * The fetcher keeps one HTTP client, and with it the connection, for all
+ * polls. The session cookie set by the site is reused until the site rejects
+ * it, only then the credentials are posted again. The validators of the last
+ * page (ETag and Last-Modified) are sent with the next request, so an
+ * unchanged page costs a 304 response without a body. Failed requests are
+ * retried with exponential backoff.
+ *
+ * The session state is caller provided and holds no pointers, it can be kept
+ * in RTC memory across deep sleep.
+ */
+
+#ifndef _FETCH_H_
+#define _FETCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <esp_err.h>
+#include <esp_http_client.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Longest session cookie, name and value, longer ones are not kept.
+ */
+#ifndef FETCH_COOKIE_MAX
+#define FETCH_COOKIE_MAX 128
+#endif
+
+/**
+ * @brief Longest ETag or Last-Modified value, longer ones are not kept.
+ */
+#ifndef FETCH_VALIDATOR_MAX
+#define FETCH_VALIDATOR_MAX 64
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Events of a fetched page body.
+ */
+typedef enum
+{
+    FETCH_BODY_BEGIN, /** A page body follows */
+    FETCH_BODY_DATA,  /** The next chunk of the body */
+    FETCH_BODY_END,   /** The body is complete */
+} fetch_body_event_t;
+
+/**
+ * @brief Receives the body of a changed page.
+ *
+ * @return At `FETCH_BODY_END`, false if the page is not the expected one,
+ *         for example a login form served for an expired session. Ignored
+ *         for other events.
+ */
+typedef bool (*fetch_body_cb_t)(fetch_body_event_t event, const char *data,
+                                size_t length, void *arg);
+
+/**
+ * @brief Session state, kept between polls.
+ */
+typedef struct
+{
+    char cookie[FETCH_COOKIE_MAX];           /** "name=value", empty if none */
+    char etag[FETCH_VALIDATOR_MAX];          /** Empty if none */
+    char last_modified[FETCH_VALIDATOR_MAX]; /** Empty if none */
+    uint32_t failures;                       /** Polls failed in a row */
+} fetch_session_t;
+
+/**
+ * @brief Fetcher configuration.
+ */
+typedef struct
+{
+    const char *page_url;    /** The polled page */
+    const char *login_url;   /** Where the credentials are posted */
+    const char *login_body;  /** The urlencoded login form fields */
+    const char *cookie_name; /** Name of the session cookie */
+    const char *cert_pem;
+    const char *user_agent;
+    fetch_body_cb_t on_body;
+    void *arg;
+    int timeout_ms;
+    uint32_t attempts;       /** Requests per poll at most, logins excluded */
+    uint32_t backoff_ms;     /** Delay before the first retry */
+    uint32_t backoff_max_ms; /** The delay doubles per retry up to this */
+} fetch_config_t;
+
+/**
+ * @brief Result of a poll.
+ */
+typedef enum
+{
+    FETCH_CHANGED,      /** The page was received */
+    FETCH_NOT_MODIFIED, /** The page has not changed since the last poll */
+} fetch_result_t;
+
+/**
+ * @brief Fetcher counters, accumulated since init.
+ */
+typedef struct
+{
+    uint32_t polls;
+    uint32_t requests;      /** All requests, logins included */
+    uint32_t logins;        /** Credential posts */
+    uint32_t not_modified;  /** Polls answered with 304 */
+    uint32_t retries;       /** Requests repeated after a failure */
+    uint32_t last_requests; /** Requests of the last poll */
+    int64_t last_poll_us;   /** Duration of the last poll */
+} fetch_stats_t;
+
+/**
+ * @brief A fetcher.
+ */
+typedef struct
+{
+    fetch_config_t config;
+    fetch_session_t *session;
+    esp_http_client_handle_t client;
+    fetch_stats_t stats;
+    bool in_page;      /** The current response is a page to pass on */
+    bool body_started; /** `FETCH_BODY_BEGIN` was reported */
+    char etag[FETCH_VALIDATOR_MAX];          /** Of the current response */
+    char last_modified[FETCH_VALIDATOR_MAX]; /** Of the current response */
+} fetch_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Create a fetcher.
+ *
+ * @param session Session storage, zeroed for a new session. It must remain
+ *                valid as long as the fetcher, as must the strings of the
+ *                configuration.
+ */
+esp_err_t fetch_init(fetch_t *fetch, const fetch_config_t *config,
+                     fetch_session_t *session);
+
+/**
+ * @brief Fetch the page if it changed, logging in if needed.
+ *
+ * @return ESP_OK with the result,
+ *         ESP_ERR_NOT_FOUND if the page is rejected even after a fresh login,
+ *         ESP_ERR_INVALID_RESPONSE if the site answered with an error, or the
+ *         transport error of the last attempt.
+ */
+esp_err_t fetch_poll(fetch_t *fetch, fetch_result_t *result);
+
+/**
+ * @brief Suggested delay before the next poll after failures, 0 if the last
+ *        poll succeeded.
+ *
+ * @param interval_ms The regular poll interval, the delay does not exceed it.
+ */
+uint32_t fetch_retry_delay_ms(const fetch_t *fetch, uint32_t interval_ms);
+
+/**
+ * @brief Get the fetcher counters.
+ */
+void fetch_get_stats(const fetch_t *fetch, fetch_stats_t *stats);
+
+/**
+ * @brief Close the connection and free the client, the session is kept.
+ */
+void fetch_deinit(fetch_t *fetch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
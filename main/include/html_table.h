@@ -0,0 +1,152 @@
+/**
+ * Streaming extraction of an HTML table.
+ *
+ * The parser is fed the response body chunk by chunk as it arrives and keeps
+ * only the current tag and the current cell text, so memory use does not
+ * depend on the page size. It finds the first table whose start tag and
+ * caption match, and reports its caption, cells and row ends through a
+ * callback. Markup inside cells is dropped, white space is collapsed, text
+ * is passed on in the encoding of the page with entities left as they are.
+ */
+
+#ifndef _HTML_TABLE_H_
+#define _HTML_TABLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Longest start tag kept for matching, longer tags are truncated.
+ */
+#ifndef HTML_TABLE_TAG_MAX
+#define HTML_TABLE_TAG_MAX 128
+#endif
+
+/**
+ * @brief Longest cell or caption text, longer text is truncated.
+ */
+#ifndef HTML_TABLE_TEXT_MAX
+#define HTML_TABLE_TEXT_MAX 256
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Structure events of the target table.
+ */
+typedef enum
+{
+    HTML_TABLE_CAPTION, /** The caption, before any cell */
+    HTML_TABLE_CELL,    /** A `td` or `th` cell */
+    HTML_TABLE_ROW_END, /** The end of a row */
+    HTML_TABLE_END,     /** The end of the table, no more events follow */
+} html_table_event_t;
+
+/**
+ * @brief Receives the events of the target table.
+ *
+ * @param text The text of a caption or cell, not NUL terminated, NULL for
+ *             other events.
+ */
+typedef void (*html_table_callback_t)(html_table_event_t event,
+                                      const char *text, uint32_t length,
+                                      void *arg);
+
+typedef enum
+{
+    HTML_TABLE_STATE_TEXT,
+    HTML_TABLE_STATE_TAG,
+    HTML_TABLE_STATE_COMMENT,
+    HTML_TABLE_STATE_RAW, /** Script or style content */
+} html_table_state_t;
+
+/**
+ * @brief Parser state, kept between chunks.
+ */
+typedef struct
+{
+    const char *table_match;   /** Required in the table start tag */
+    const char *caption_match; /** Required in the caption text */
+    html_table_callback_t callback;
+    void *arg;
+
+    html_table_state_t state;
+    char tag[HTML_TABLE_TAG_MAX];
+    uint32_t tag_length;
+    char quote;               /** Quote of the current attribute value */
+    uint32_t comment_dashes;  /** Dashes seen before a possible `>` */
+    const char *raw_end;      /** End tag of script or style content */
+    uint32_t raw_matched;     /** Characters of `raw_end` seen */
+
+    char text[HTML_TABLE_TEXT_MAX];
+    uint32_t text_length;
+    bool space;               /** White space pending before more text */
+
+    bool in_table;            /** Inside a table with a matching start tag */
+    bool matched;             /** The caption matched, events are reported */
+    uint32_t nesting;         /** Tables nested in the target table */
+    bool in_caption;
+    bool in_row;
+    bool in_cell;
+    bool done;                /** The target table has ended */
+} html_table_parser_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Prepare a parser for a new document.
+ *
+ * @param table_match   Text the table start tag must contain, NULL for any.
+ * @param caption_match Text the caption must contain, NULL for any table.
+ *                      The strings must remain valid while parsing.
+ */
+void html_table_parser_init(html_table_parser_t *parser,
+                            const char *table_match,
+                            const char *caption_match,
+                            html_table_callback_t callback, void *arg);
+
+/**
+ * @brief Parse the next chunk of the document.
+ */
+void html_table_parser_feed(html_table_parser_t *parser, const char *data,
+                            size_t length);
+
+/**
+ * @brief Returns true once the target table has been found.
+ */
+bool html_table_parser_found(const html_table_parser_t *parser);
+
+/**
+ * @brief Returns true once the target table has ended.
+ */
+bool html_table_parser_done(const html_table_parser_t *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,131 @@
+/**
+ * Reference counted message buffers for passing content between tasks.
+ *
+ * A message is a variable size buffer with a reference count. Only the
+ * pointer travels through a FreeRTOS queue, the content is written once by
+ * the producer and read in place by the consumer. Released buffers are kept
+ * for reuse, so a steady stream of similar messages does not touch the heap.
+ * Buffers live in PSRAM if available.
+ */
+
+#ifndef _MSG_POOL_H_
+#define _MSG_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Number of released buffers kept for reuse.
+ */
+#ifndef MSG_POOL_FREE_BUFFERS
+#define MSG_POOL_FREE_BUFFERS 4
+#endif
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A message.
+ */
+typedef struct
+{
+    uint32_t refs;     /** References, the buffer returns to the pool at 0 */
+    uint32_t type;     /** Kind of content, defined by the user */
+    uint32_t capacity; /** Size of `data` in bytes */
+    uint32_t length;   /** Bytes of `data` in use */
+    uint8_t data[];
+} msg_buffer_t;
+
+/**
+ * @brief Pool counters.
+ */
+typedef struct
+{
+    uint32_t allocations; /** Buffers taken from the heap */
+    uint32_t reuses;      /** Buffers taken from the pool */
+    uint32_t live;        /** Buffers currently referenced */
+    uint32_t free;        /** Buffers currently kept for reuse */
+    uint32_t coalesced;   /** Messages dropped for a newer one */
+} msg_pool_stats_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Get a buffer of at least `size` bytes, with one reference.
+ *
+ * @return The buffer with `length` 0, or NULL if out of memory.
+ */
+msg_buffer_t *msg_pool_alloc(uint32_t type, uint32_t size);
+
+/**
+ * @brief Add a reference.
+ *
+ * @return The buffer.
+ */
+msg_buffer_t *msg_pool_retain(msg_buffer_t *msg);
+
+/**
+ * @brief Drop a reference, the last one returns the buffer to the pool.
+ */
+void msg_pool_release(msg_buffer_t *msg);
+
+/**
+ * @brief Send a message through a queue of `msg_buffer_t` pointers.
+ *
+ * The reference of the caller moves to the receiver. If the queue stays full
+ * for `wait` ticks, the message is released.
+ *
+ * @return pdTRUE if the message was queued.
+ */
+BaseType_t msg_pool_send(QueueHandle_t queue, msg_buffer_t *msg,
+                         TickType_t wait);
+
+/**
+ * @brief Receive the newest message of a queue of `msg_buffer_t` pointers.
+ *
+ * Waits up to `wait` ticks for a message, then releases all but the last of
+ * the pending ones.
+ *
+ * @return The message with the reference of the sender, or NULL on timeout.
+ */
+msg_buffer_t *msg_pool_receive_latest(QueueHandle_t queue, TickType_t wait);
+
+/**
+ * @brief Free the buffers kept for reuse.
+ */
+void msg_pool_trim();
+
+/**
+ * @brief Get the pool counters.
+ */
+void msg_pool_get_stats(msg_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
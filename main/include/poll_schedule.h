@@ -0,0 +1,158 @@
+/**
+ * Scheduling of page polls between deep sleeps.
+ *
+ * The schedule lives in RTC memory and decides on each wake whether to poll
+ * now or to sleep again, and after a poll when the next one is due. While the
+ * page does not change, the interval is stretched up to a maximum, a change
+ * brings it back to the base interval. Failed polls are retried after the
+ * delay given by the caller, without changing the interval.
+ *
+ * Time is passed in by the caller, in milliseconds of a clock that keeps
+ * running in deep sleep. The module has no hardware dependencies.
+ */
+
+#ifndef _POLL_SCHEDULE_H_
+#define _POLL_SCHEDULE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Schedule magic, "EPDP".
+ */
+#define POLL_SCHEDULE_MAGIC 0x50445045
+
+/**
+ * @brief Current schedule layout version.
+ */
+#define POLL_SCHEDULE_VERSION 1
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Schedule configuration.
+ */
+typedef struct
+{
+    uint32_t interval_ms;     /** Base interval between polls */
+    uint32_t max_interval_ms; /** Longest interval while nothing changes */
+    uint32_t stretch_after;   /** Unchanged polls before the interval grows */
+    uint32_t min_sleep_ms;    /** Shorter waits are not worth a deep sleep */
+} poll_schedule_config_t;
+
+/**
+ * @brief Outcome of a poll.
+ */
+typedef enum
+{
+    POLL_CHANGED,   /** New content was received */
+    POLL_UNCHANGED, /** The content has not changed */
+    POLL_FAILED,    /** The content could not be fetched */
+} poll_outcome_t;
+
+/**
+ * @brief What to do after a wake.
+ */
+typedef enum
+{
+    POLL_ACTION_POLL,  /** A poll is due */
+    POLL_ACTION_SLEEP, /** Sleep until the next poll */
+} poll_action_t;
+
+/**
+ * @brief Schedule state, kept in RTC memory.
+ */
+typedef struct
+{
+    uint32_t magic;          /** `POLL_SCHEDULE_MAGIC` */
+    uint32_t version;        /** `POLL_SCHEDULE_VERSION` */
+    uint64_t next_poll_ms;   /** Clock time the next poll is due */
+    uint64_t last_change_ms; /** Clock time of the last changed poll */
+    uint32_t interval_ms;    /** The current interval */
+    uint32_t unchanged;      /** Unchanged polls in a row */
+    uint32_t failures;       /** Failed polls in a row */
+    uint32_t polls;
+    uint32_t wakeups;
+    uint32_t reserved;
+    uint64_t checksum;       /** Of the fields above, set by sealing */
+} poll_schedule_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Start a schedule with a poll due now.
+ */
+void poll_schedule_init(poll_schedule_t *schedule,
+                        const poll_schedule_config_t *config, uint64_t now_ms);
+
+/**
+ * @brief Check a schedule restored from RTC memory.
+ *
+ * @return false after power on, or if the memory is corrupt or from another
+ *         firmware version.
+ */
+bool poll_schedule_valid(const poll_schedule_t *schedule);
+
+/**
+ * @brief Update the checksum, before the schedule is left in RTC memory.
+ */
+void poll_schedule_seal(poll_schedule_t *schedule);
+
+/**
+ * @brief Decide what to do after a wake.
+ *
+ * A due time further away than the maximum interval means the clock was
+ * reset, a poll is due then.
+ *
+ * @param sleep_ms Set to the time until the next poll for
+ *                 `POLL_ACTION_SLEEP`.
+ */
+poll_action_t poll_schedule_next(poll_schedule_t *schedule,
+                                 const poll_schedule_config_t *config,
+                                 uint64_t now_ms, uint32_t *sleep_ms);
+
+/**
+ * @brief Plan the next poll after one has finished.
+ *
+ * @param retry_delay_ms Delay before retrying a failed poll, the base
+ *                       interval if 0.
+ */
+void poll_schedule_update(poll_schedule_t *schedule,
+                          const poll_schedule_config_t *config,
+                          uint64_t now_ms, poll_outcome_t outcome,
+                          uint32_t retry_delay_ms);
+
+/**
+ * @brief Time until the next poll, 0 if it is due.
+ */
+uint32_t poll_schedule_remaining_ms(const poll_schedule_t *schedule,
+                                    uint64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
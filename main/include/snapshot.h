@@ -0,0 +1,113 @@
+/**
+ * Snapshots of the displayed content, persisted in a file.
+ *
+ * An e-paper panel keeps its image without power, but the application
+ * forgets what it drew on reset. A snapshot stores the content behind the
+ * image, a compact display list rather than the framebuffer, together with
+ * its content hash, so it can be compared with new content or drawn again
+ * without fetching it. Snapshots are written to a temporary file and renamed,
+ * a reset while saving leaves the previous one intact. A checksum rejects
+ * corrupt files.
+ *
+ *     snapshot_header_t
+ *     data [length]
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <esp_err.h>
+
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Snapshot file magic, "EPDS".
+ */
+#define SNAPSHOT_MAGIC 0x53445045
+
+/**
+ * @brief Current snapshot format version.
+ */
+#define SNAPSHOT_VERSION 1
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Snapshot header.
+ */
+typedef struct
+{
+    uint32_t magic;    /** `SNAPSHOT_MAGIC` */
+    uint16_t version;  /** `SNAPSHOT_VERSION` */
+    uint16_t type;     /** Kind of content, defined by the user */
+    uint32_t length;   /** Size of the data in bytes */
+    uint32_t reserved;
+    uint64_t hash;     /** Content hash, defined by the user */
+    uint64_t checksum; /** FNV-1a hash of the data */
+} snapshot_header_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Save a snapshot, replacing the previous one.
+ *
+ * A snapshot with the same hash and data is not written again, to spare the
+ * flash.
+ *
+ * @param path The file, on a mounted file system.
+ */
+esp_err_t snapshot_save(const char *path, uint16_t type, uint64_t hash,
+                        const void *data, uint32_t length);
+
+/**
+ * @brief Read the header of a snapshot.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no snapshot,
+ *         ESP_ERR_INVALID_VERSION if it has another format.
+ */
+esp_err_t snapshot_info(const char *path, snapshot_header_t *header);
+
+/**
+ * @brief Read a snapshot.
+ *
+ * @param data At least `header->length` bytes, see `snapshot_info`.
+ *
+ * @return ESP_ERR_INVALID_SIZE if the data does not fit,
+ *         ESP_ERR_INVALID_CRC if the snapshot is corrupt.
+ */
+esp_err_t snapshot_load(const char *path, snapshot_header_t *header,
+                        void *data, uint32_t capacity);
+
+/**
+ * @brief Delete the snapshot.
+ */
+esp_err_t snapshot_remove(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
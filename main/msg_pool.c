@@ -0,0 +1,252 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "msg_pool.h"
+
+#include <esp_heap_caps.h>
+
+#include <assert.h>
+#include <stdlib.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Buffer sizes are rounded up to it, similar sizes share buffers.
+ */
+#define SIZE_GRANULE 64
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Take the smallest free buffer of at least `capacity` bytes.
+ *
+ * @note Called with `pool_lock` held.
+ */
+static msg_buffer_t *take_free(uint32_t capacity);
+
+/**
+ * @brief Keep a buffer for reuse, bigger buffers are preferred.
+ *
+ * @note Called with `pool_lock` held.
+ *
+ * @return The buffer to free, `msg` or one it replaced, or NULL.
+ */
+static msg_buffer_t *put_free(msg_buffer_t *msg);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static msg_buffer_t *free_buffers[MSG_POOL_FREE_BUFFERS];
+static msg_pool_stats_t stats;
+static portMUX_TYPE pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+msg_buffer_t *msg_pool_alloc(uint32_t type, uint32_t size)
+{
+    uint32_t capacity = (size + SIZE_GRANULE - 1) / SIZE_GRANULE * SIZE_GRANULE;
+
+    portENTER_CRITICAL(&pool_lock);
+    msg_buffer_t *msg = take_free(capacity);
+    if (msg != NULL)
+    {
+        stats.reuses++;
+        stats.live++;
+    }
+    portEXIT_CRITICAL(&pool_lock);
+
+    if (msg == NULL)
+    {
+        // the heap is not used inside the critical section.
+        size_t bytes = sizeof(msg_buffer_t) + capacity;
+        msg = (msg_buffer_t *)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+        if (msg == NULL)
+        {
+            msg = (msg_buffer_t *)malloc(bytes);
+        }
+        if (msg == NULL)
+        {
+            return NULL;
+        }
+        msg->capacity = capacity;
+
+        portENTER_CRITICAL(&pool_lock);
+        stats.allocations++;
+        stats.live++;
+        portEXIT_CRITICAL(&pool_lock);
+    }
+
+    msg->refs = 1;
+    msg->type = type;
+    msg->length = 0;
+    return msg;
+}
+
+
+msg_buffer_t *msg_pool_retain(msg_buffer_t *msg)
+{
+    portENTER_CRITICAL(&pool_lock);
+    assert(msg->refs > 0);
+    msg->refs++;
+    portEXIT_CRITICAL(&pool_lock);
+    return msg;
+}
+
+
+void msg_pool_release(msg_buffer_t *msg)
+{
+    if (msg == NULL)
+    {
+        return;
+    }
+
+    msg_buffer_t *drop = NULL;
+    portENTER_CRITICAL(&pool_lock);
+    assert(msg->refs > 0);
+    if (--msg->refs == 0)
+    {
+        stats.live--;
+        drop = put_free(msg);
+    }
+    portEXIT_CRITICAL(&pool_lock);
+
+    free(drop);
+}
+
+
+BaseType_t msg_pool_send(QueueHandle_t queue, msg_buffer_t *msg,
+                         TickType_t wait)
+{
+    if (xQueueSend(queue, &msg, wait) != pdTRUE)
+    {
+        msg_pool_release(msg);
+        return pdFALSE;
+    }
+    return pdTRUE;
+}
+
+
+msg_buffer_t *msg_pool_receive_latest(QueueHandle_t queue, TickType_t wait)
+{
+    msg_buffer_t *msg;
+    if (xQueueReceive(queue, &msg, wait) != pdTRUE)
+    {
+        return NULL;
+    }
+
+    // whatever is pending is newer, the older message is never shown.
+    msg_buffer_t *newer;
+    while (xQueueReceive(queue, &newer, 0) == pdTRUE)
+    {
+        msg_pool_release(msg);
+        msg = newer;
+
+        portENTER_CRITICAL(&pool_lock);
+        stats.coalesced++;
+        portEXIT_CRITICAL(&pool_lock);
+    }
+    return msg;
+}
+
+
+void msg_pool_trim()
+{
+    msg_buffer_t *drop[MSG_POOL_FREE_BUFFERS];
+
+    portENTER_CRITICAL(&pool_lock);
+    for (uint32_t i = 0; i < MSG_POOL_FREE_BUFFERS; i++)
+    {
+        drop[i] = free_buffers[i];
+        free_buffers[i] = NULL;
+    }
+    stats.free = 0;
+    portEXIT_CRITICAL(&pool_lock);
+
+    for (uint32_t i = 0; i < MSG_POOL_FREE_BUFFERS; i++)
+    {
+        free(drop[i]);
+    }
+}
+
+
+void msg_pool_get_stats(msg_pool_stats_t *out)
+{
+    portENTER_CRITICAL(&pool_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&pool_lock);
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static msg_buffer_t *take_free(uint32_t capacity)
+{
+    int32_t best = -1;
+    for (uint32_t i = 0; i < MSG_POOL_FREE_BUFFERS; i++)
+    {
+        msg_buffer_t *candidate = free_buffers[i];
+        if (candidate != NULL && candidate->capacity >= capacity &&
+            (best < 0 || candidate->capacity < free_buffers[best]->capacity))
+        {
+            best = i;
+        }
+    }
+    if (best < 0)
+    {
+        return NULL;
+    }
+
+    msg_buffer_t *msg = free_buffers[best];
+    free_buffers[best] = NULL;
+    stats.free--;
+    return msg;
+}
+
+
+static msg_buffer_t *put_free(msg_buffer_t *msg)
+{
+    int32_t smallest = -1;
+    for (uint32_t i = 0; i < MSG_POOL_FREE_BUFFERS; i++)
+    {
+        if (free_buffers[i] == NULL)
+        {
+            free_buffers[i] = msg;
+            stats.free++;
+            return NULL;
+        }
+        if (smallest < 0 ||
+            free_buffers[i]->capacity < free_buffers[smallest]->capacity)
+        {
+            smallest = i;
+        }
+    }
+
+    if (free_buffers[smallest]->capacity >= msg->capacity)
+    {
+        return msg;
+    }
+    msg_buffer_t *drop = free_buffers[smallest];
+    free_buffers[smallest] = msg;
+    return drop;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
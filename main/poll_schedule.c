@@ -0,0 +1,145 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "poll_schedule.h"
+#include "fnv.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static uint64_t schedule_checksum(const poll_schedule_t *schedule);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void poll_schedule_init(poll_schedule_t *schedule,
+                        const poll_schedule_config_t *config, uint64_t now_ms)
+{
+    memset(schedule, 0, sizeof(poll_schedule_t));
+    schedule->magic = POLL_SCHEDULE_MAGIC;
+    schedule->version = POLL_SCHEDULE_VERSION;
+    schedule->next_poll_ms = now_ms;
+    schedule->last_change_ms = now_ms;
+    schedule->interval_ms = config->interval_ms;
+    poll_schedule_seal(schedule);
+}
+
+
+bool poll_schedule_valid(const poll_schedule_t *schedule)
+{
+    return schedule->magic == POLL_SCHEDULE_MAGIC &&
+           schedule->version == POLL_SCHEDULE_VERSION &&
+           schedule->checksum == schedule_checksum(schedule);
+}
+
+
+void poll_schedule_seal(poll_schedule_t *schedule)
+{
+    schedule->checksum = schedule_checksum(schedule);
+}
+
+
+poll_action_t poll_schedule_next(poll_schedule_t *schedule,
+                                 const poll_schedule_config_t *config,
+                                 uint64_t now_ms, uint32_t *sleep_ms)
+{
+    schedule->wakeups++;
+
+    // a clock that went back would postpone the poll for too long.
+    if (schedule->next_poll_ms > now_ms + config->max_interval_ms)
+    {
+        schedule->next_poll_ms = now_ms;
+    }
+
+    uint32_t remaining = poll_schedule_remaining_ms(schedule, now_ms);
+    if (remaining < config->min_sleep_ms)
+    {
+        return POLL_ACTION_POLL;
+    }
+    *sleep_ms = remaining;
+    return POLL_ACTION_SLEEP;
+}
+
+
+void poll_schedule_update(poll_schedule_t *schedule,
+                          const poll_schedule_config_t *config,
+                          uint64_t now_ms, poll_outcome_t outcome,
+                          uint32_t retry_delay_ms)
+{
+    schedule->polls++;
+    switch (outcome)
+    {
+    case POLL_CHANGED:
+        schedule->interval_ms = config->interval_ms;
+        schedule->unchanged = 0;
+        schedule->failures = 0;
+        schedule->last_change_ms = now_ms;
+        break;
+    case POLL_UNCHANGED:
+        schedule->failures = 0;
+        // a quiet page is polled less often, a change resets it.
+        if (++schedule->unchanged >= config->stretch_after &&
+            schedule->interval_ms < config->max_interval_ms)
+        {
+            schedule->interval_ms =
+                schedule->interval_ms * 2 < config->max_interval_ms
+                    ? schedule->interval_ms * 2
+                    : config->max_interval_ms;
+        }
+        break;
+    case POLL_FAILED:
+        schedule->failures++;
+        schedule->next_poll_ms =
+            now_ms + (retry_delay_ms > 0 ? retry_delay_ms : config->interval_ms);
+        return;
+    }
+    schedule->next_poll_ms = now_ms + schedule->interval_ms;
+}
+
+
+uint32_t poll_schedule_remaining_ms(const poll_schedule_t *schedule,
+                                    uint64_t now_ms)
+{
+    if (schedule->next_poll_ms <= now_ms)
+    {
+        return 0;
+    }
+    uint64_t remaining = schedule->next_poll_ms - now_ms;
+    return remaining < UINT32_MAX ? (uint32_t)remaining : UINT32_MAX;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static uint64_t schedule_checksum(const poll_schedule_t *schedule)
+{
+    return fnv1a_64(FNV1A_64_INIT, schedule,
+                    offsetof(poll_schedule_t, checksum));
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
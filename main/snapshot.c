@@ -0,0 +1,257 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "snapshot.h"
+#include "fnv.h"
+
+#include <esp_log.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Bytes read at a time when checking a snapshot.
+ */
+#define VERIFY_CHUNK 256
+
+/**
+ * @brief Longest snapshot path, including the temporary file suffix.
+ */
+#define PATH_MAX_LENGTH 64
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static esp_err_t read_header(FILE *file, snapshot_header_t *header);
+
+/**
+ * @brief Read the header of a snapshot and check its data.
+ */
+static esp_err_t verify_file(const char *path, snapshot_header_t *header);
+
+/**
+ * @brief Get the path of the temporary file of a snapshot.
+ */
+static bool temp_path_of(const char *path, char *temp_path);
+
+/**
+ * @brief Complete a save cut short between removing the old snapshot and
+ *        renaming the new one.
+ *
+ * If the snapshot is missing and its temporary file verifies, the temporary
+ * file becomes the snapshot.
+ */
+static void recover_temp(const char *path);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "snapshot";
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+esp_err_t snapshot_save(const char *path, uint16_t type, uint64_t hash,
+                        const void *data, uint32_t length)
+{
+    snapshot_header_t header = {
+        .magic = SNAPSHOT_MAGIC,
+        .version = SNAPSHOT_VERSION,
+        .type = type,
+        .length = length,
+        .hash = hash,
+        .checksum = fnv1a_64(FNV1A_64_INIT, data, length),
+    };
+
+    snapshot_header_t saved;
+    if (verify_file(path, &saved) == ESP_OK &&
+        memcmp(&saved, &header, sizeof(header)) == 0)
+    {
+        return ESP_OK;
+    }
+
+    char temp_path[PATH_MAX_LENGTH];
+    if (!temp_path_of(path, temp_path))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    FILE *file = fopen(temp_path, "wb");
+    if (file == NULL)
+    {
+        ESP_LOGE(TAG, "cannot create %s", temp_path);
+        return ESP_FAIL;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   (length == 0 || fwrite(data, length, 1, file) == 1);
+    if (fclose(file) != 0 || !written)
+    {
+        ESP_LOGE(TAG, "cannot write %s", temp_path);
+        remove(temp_path);
+        return ESP_FAIL;
+    }
+
+    // SPIFFS does not rename over a file. A reset after the remove leaves
+    // only the complete temporary file, which recover_temp() picks up.
+    remove(path);
+    if (rename(temp_path, path) != 0)
+    {
+        ESP_LOGE(TAG, "cannot rename %s", temp_path);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t snapshot_info(const char *path, snapshot_header_t *header)
+{
+    recover_temp(path);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = read_header(file, header);
+    fclose(file);
+    return err;
+}
+
+
+esp_err_t snapshot_load(const char *path, snapshot_header_t *header,
+                        void *data, uint32_t capacity)
+{
+    recover_temp(path);
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = read_header(file, header);
+    if (err == ESP_OK && header->length > capacity)
+    {
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err == ESP_OK && header->length > 0 &&
+        fread(data, header->length, 1, file) != 1)
+    {
+        err = ESP_ERR_INVALID_CRC;
+    }
+    if (err == ESP_OK &&
+        fnv1a_64(FNV1A_64_INIT, data, header->length) != header->checksum)
+    {
+        err = ESP_ERR_INVALID_CRC;
+    }
+    fclose(file);
+
+    if (err == ESP_ERR_INVALID_CRC)
+    {
+        ESP_LOGW(TAG, "%s is corrupt", path);
+    }
+    return err;
+}
+
+
+esp_err_t snapshot_remove(const char *path)
+{
+    char temp_path[PATH_MAX_LENGTH];
+    bool removed_temp = temp_path_of(path, temp_path) && remove(temp_path) == 0;
+    return remove(path) == 0 || removed_temp ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static esp_err_t read_header(FILE *file, snapshot_header_t *header)
+{
+    if (fread(header, sizeof(snapshot_header_t), 1, file) != 1 ||
+        header->magic != SNAPSHOT_MAGIC)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (header->version != SNAPSHOT_VERSION)
+    {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return ESP_OK;
+}
+
+
+static esp_err_t verify_file(const char *path, snapshot_header_t *header)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = read_header(file, header);
+    uint64_t checksum = FNV1A_64_INIT;
+    uint8_t chunk[VERIFY_CHUNK];
+    for (uint32_t left = header->length; err == ESP_OK && left > 0;)
+    {
+        size_t size = left < sizeof(chunk) ? left : sizeof(chunk);
+        if (fread(chunk, size, 1, file) != 1)
+        {
+            err = ESP_ERR_INVALID_CRC;
+            break;
+        }
+        checksum = fnv1a_64(checksum, chunk, size);
+        left -= size;
+    }
+    if (err == ESP_OK && checksum != header->checksum)
+    {
+        err = ESP_ERR_INVALID_CRC;
+    }
+    fclose(file);
+    return err;
+}
+
+
+static bool temp_path_of(const char *path, char *temp_path)
+{
+    return snprintf(temp_path, PATH_MAX_LENGTH, "%s.tmp", path) <
+           PATH_MAX_LENGTH;
+}
+
+
+static void recover_temp(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file != NULL)
+    {
+        fclose(file);
+        return;
+    }
+
+    char temp_path[PATH_MAX_LENGTH];
+    snapshot_header_t header;
+    if (temp_path_of(path, temp_path) &&
+        verify_file(temp_path, &header) == ESP_OK &&
+        rename(temp_path, path) == 0)
+    {
+        ESP_LOGI(TAG, "%s recovered from its temporary file", path);
+    }
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
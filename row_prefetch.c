@@ -0,0 +1,300 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "row_prefetch.h"
+
+#include <esp_assert.h>
+#include <esp_heap_caps.h>
+#include <esp_idf_version.h>
+#include <esp_log.h>
+#include <soc/soc_caps.h>
+#include <xtensa/core-macros.h>
+
+#include <string.h>
+
+#if SOC_GDMA_SUPPORTED && CONFIG_SPIRAM && \
+    ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#define ROW_PREFETCH_USE_DMA 1
+#include <esp_async_memcpy.h>
+#include <esp_cache.h>
+#else
+#define ROW_PREFETCH_USE_DMA 0
+#endif
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Alignment of DMA transfers from / to external memory.
+ */
+#define PSRAM_ALIGN 64
+
+/**
+ * @brief Size of a row slot, including room to align the source down.
+ */
+#define SLOT_BYTES (ROW_PREFETCH_MAX_ROW_BYTES + 2 * PSRAM_ALIGN)
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    uint8_t *buf;
+    /// Offset of the requested row start within `buf`.
+    uint32_t offset;
+    /// Set by the DMA completion callback.
+    volatile bool ready;
+} row_slot_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Start fetching a row into a slot.
+ */
+static void IRAM_ATTR fetch_row(int32_t row);
+
+#if ROW_PREFETCH_USE_DMA
+/**
+ * @brief DMA completion callback, marks a slot as ready.
+ */
+static bool IRAM_ATTR copy_done(async_memcpy_handle_t handle,
+                                async_memcpy_event_t *event, void *args);
+#endif
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "row_prefetch";
+
+static row_slot_t slots[ROW_PREFETCH_DEPTH];
+
+#if ROW_PREFETCH_USE_DMA
+static async_memcpy_handle_t memcpy_handle = NULL;
+#endif
+
+/**
+ * @brief Current prefetch sequence.
+ */
+static const uint8_t *seq_first_row;
+static uint32_t seq_stride;
+static uint32_t seq_row_bytes;
+static int32_t seq_rows;
+static int32_t seq_next;
+static bool seq_dma;
+
+static row_prefetch_stats_t stats;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void row_prefetch_init()
+{
+    if (slots[0].buf != NULL)
+    {
+        return;
+    }
+
+    for (int32_t i = 0; i < ROW_PREFETCH_DEPTH; i++)
+    {
+        slots[i].buf = (uint8_t *)heap_caps_aligned_alloc(
+            PSRAM_ALIGN, SLOT_BYTES, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        assert(slots[i].buf != NULL);
+        slots[i].ready = true;
+    }
+
+#if ROW_PREFETCH_USE_DMA
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.backlog = ROW_PREFETCH_DEPTH;
+    config.psram_trans_align = PSRAM_ALIGN;
+    config.sram_trans_align = 4;
+    if (esp_async_memcpy_install(&config, &memcpy_handle) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "async memcpy unavailable, using CPU copies");
+        memcpy_handle = NULL;
+    }
+#endif
+}
+
+
+bool row_prefetch_uses_dma()
+{
+#if ROW_PREFETCH_USE_DMA
+    return memcpy_handle != NULL;
+#else
+    return false;
+#endif
+}
+
+
+void row_prefetch_sync(const uint8_t *data, uint32_t len)
+{
+#if ROW_PREFETCH_USE_DMA
+    if (!row_prefetch_uses_dma())
+    {
+        return;
+    }
+    uint32_t start = (uint32_t)data & ~(PSRAM_ALIGN - 1);
+    uint32_t end = ((uint32_t)data + len + PSRAM_ALIGN - 1) & ~(PSRAM_ALIGN - 1);
+    esp_cache_msync((void *)start, end - start, ESP_CACHE_MSYNC_FLAG_DIR_C2M);
+#endif
+}
+
+
+void row_prefetch_begin(const uint8_t *first_row, uint32_t stride,
+                        uint32_t row_bytes, int32_t rows)
+{
+    assert(slots[0].buf != NULL);
+
+    seq_first_row = first_row;
+    seq_stride = stride;
+    seq_row_bytes = row_bytes > ROW_PREFETCH_MAX_ROW_BYTES
+                        ? ROW_PREFETCH_MAX_ROW_BYTES : row_bytes;
+    seq_rows = rows;
+    seq_next = 0;
+    seq_dma = row_prefetch_uses_dma();
+
+    // fill the pipeline, except for the slot of the last consumed row.
+    for (int32_t i = 0; i < ROW_PREFETCH_DEPTH - 1 && i < rows; i++)
+    {
+        fetch_row(i);
+    }
+}
+
+
+const uint8_t * IRAM_ATTR row_prefetch_next()
+{
+    int32_t row = seq_next++;
+    assert(row < seq_rows);
+
+    // the slot of the previous row is free again.
+    if (row + ROW_PREFETCH_DEPTH - 1 < seq_rows)
+    {
+        fetch_row(row + ROW_PREFETCH_DEPTH - 1);
+    }
+
+    row_slot_t *slot = &slots[row % ROW_PREFETCH_DEPTH];
+    uint32_t start = XTHAL_GET_CCOUNT();
+    bool stalled = false;
+    if (seq_dma)
+    {
+        stalled = !slot->ready;
+        while (!slot->ready) ;
+    }
+    else
+    {
+        // without DMA, the copy itself is the PSRAM stall.
+        stalled = true;
+        memcpy(slot->buf, seq_first_row + row * seq_stride, seq_row_bytes);
+    }
+
+    if (stalled)
+    {
+        uint32_t cycles = XTHAL_GET_CCOUNT() - start;
+        stats.stalls++;
+        stats.stall_cycles += cycles;
+        if (cycles > stats.max_stall_cycles)
+        {
+            stats.max_stall_cycles = cycles;
+        }
+    }
+    stats.rows++;
+    return slot->buf + slot->offset;
+}
+
+
+void IRAM_ATTR row_prefetch_skip()
+{
+    int32_t row = seq_next++;
+    assert(row < seq_rows);
+
+    if (row + ROW_PREFETCH_DEPTH - 1 < seq_rows)
+    {
+        fetch_row(row + ROW_PREFETCH_DEPTH - 1);
+    }
+}
+
+
+void row_prefetch_end()
+{
+    for (int32_t i = 0; i < ROW_PREFETCH_DEPTH; i++)
+    {
+        while (!slots[i].ready) ;
+    }
+    seq_rows = 0;
+}
+
+
+void row_prefetch_get_stats(row_prefetch_stats_t *out)
+{
+    *out = stats;
+}
+
+
+void row_prefetch_reset_stats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static void IRAM_ATTR fetch_row(int32_t row)
+{
+    row_slot_t *slot = &slots[row % ROW_PREFETCH_DEPTH];
+
+    if (!seq_dma)
+    {
+        slot->offset = 0;
+        return;
+    }
+
+#if ROW_PREFETCH_USE_DMA
+    const uint8_t *src = seq_first_row + row * seq_stride;
+
+    // a skipped row may still occupy the slot.
+    while (!slot->ready) ;
+
+    // DMA from PSRAM needs aligned addresses and sizes, so fetch the
+    // surrounding aligned block and remember where the row starts.
+    uint32_t start = (uint32_t)src & ~(PSRAM_ALIGN - 1);
+    uint32_t end = ((uint32_t)src + seq_row_bytes + PSRAM_ALIGN - 1) &
+                   ~(PSRAM_ALIGN - 1);
+    slot->offset = (uint32_t)src - start;
+    slot->ready = false;
+    if (esp_async_memcpy(memcpy_handle, slot->buf, (void *)start, end - start,
+                         copy_done, slot) != ESP_OK)
+    {
+        memcpy(slot->buf + slot->offset, src, seq_row_bytes);
+        slot->ready = true;
+        return;
+    }
+    stats.dma_rows++;
+#endif
+}
+
+
+#if ROW_PREFETCH_USE_DMA
+static bool IRAM_ATTR copy_done(async_memcpy_handle_t handle,
+                                async_memcpy_event_t *event, void *args)
+{
+    row_slot_t *slot = (row_slot_t *)args;
+    slot->ready = true;
+    return false;
+}
+#endif
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
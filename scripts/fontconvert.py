@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+"""
+Compile TrueType / OpenType fonts into GFXfont data for the e-paper driver.
+
+Glyphs are rendered with FreeType, quantized to 4 bits per pixel (two pixels
+per byte, the left pixel in the low nibble, rows padded to whole bytes) and
+optionally zlib compressed one by one. Code points the font provides are
+merged into the fewest possible UnicodeIntervals.
+
+The output is either a C header defining a GFXfont, or a font pack for
+font_pack_mount(). Writing to an existing pack adds the font to it, a font
+of the same name and size is replaced.
+
+Examples:
+
+    fontconvert.py firasans 12 FiraSans-Regular.ttf --compress \\
+        --range czech > include/font/firasans.h
+    fontconvert.py firasans 20 FiraSans-Regular.ttf --compress \\
+        --range czech --pack fonts.bin --stats
+
+Requires the freetype-py package.
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+import zlib
+
+import freetype
+
+FONT_PACK_MAGIC = 0x46445045
+FONT_PACK_VERSION = 1
+FONT_PACK_NAME_LEN = 24
+
+HEADER = struct.Struct("<IHHII")
+ENTRY = struct.Struct("<%dsHBBiiIIIIII" % FONT_PACK_NAME_LEN)
+INTERVAL = struct.Struct("<III")
+GLYPH = struct.Struct("<BBBxhhHxxI")
+
+# the renderer indexes code points below this in a direct table.
+DIRECT_CPS = 256
+
+RANGES = {
+    "ascii": [(0x20, 0x7E)],
+    "latin1": [(0x20, 0x7E), (0xA0, 0xFF)],
+    "czech": [
+        (0x20, 0x7E),
+        (0xA0, 0xA0), (0xA7, 0xA7), (0xB0, 0xB0),
+        (0xC1, 0xC1), (0xC9, 0xC9), (0xCD, 0xCD), (0xD3, 0xD3),
+        (0xDA, 0xDA), (0xDD, 0xDD), (0xE1, 0xE1), (0xE9, 0xE9),
+        (0xED, 0xED), (0xF3, 0xF3), (0xFA, 0xFA), (0xFD, 0xFD),
+        (0x10C, 0x10F), (0x11A, 0x11B), (0x147, 0x148), (0x158, 0x159),
+        (0x160, 0x161), (0x164, 0x165), (0x16E, 0x16F), (0x17D, 0x17E),
+        (0x2013, 0x2014), (0x2018, 0x201A), (0x201C, 0x201E),
+        (0x2026, 0x2026), (0x20AC, 0x20AC), (0xFFFD, 0xFFFD),
+    ],
+}
+
+
+def parse_range(text):
+    """A preset name, a code point or a first-last code point range."""
+    if text in RANGES:
+        return RANGES[text]
+    first, _, last = text.partition("-")
+    first = int(first, 0)
+    last = int(last, 0) if last else first
+    if last < first:
+        raise argparse.ArgumentTypeError("empty range %s" % text)
+    return [(first, last)]
+
+
+def merge_intervals(code_points):
+    """Sorted code points to maximal runs of consecutive code points."""
+    intervals = []
+    for cp in code_points:
+        if intervals and intervals[-1][1] == cp - 1:
+            intervals[-1][1] = cp
+        else:
+            intervals.append([cp, cp])
+    return intervals
+
+
+def quantize(bitmap):
+    """8 bit coverage to 4 bit, two pixels per byte, rows padded."""
+    data = bytearray()
+    for y in range(bitmap.rows):
+        row = bitmap.buffer[y * bitmap.pitch:y * bitmap.pitch + bitmap.width]
+        levels = [(v * 15 + 127) // 255 for v in row]
+        if len(levels) % 2:
+            levels.append(0)
+        for x in range(0, len(levels), 2):
+            data.append(levels[x] | (levels[x + 1] << 4))
+    return bytes(data)
+
+
+class Font:
+    def __init__(self, name, size, compressed):
+        self.name = name
+        self.size = size
+        self.compressed = compressed
+        self.advance_y = 0
+        self.ascender = 0
+        self.descender = 0
+        self.intervals = []
+        self.glyphs = []
+        self.bitmap = b""
+
+
+def compile_font(args, code_points):
+    faces = [freetype.Face(path) for path in args.fonts]
+    for face in faces:
+        face.set_char_size(args.size << 6, args.size << 6, args.dpi, args.dpi)
+
+    font = Font(args.name, args.size, args.compress)
+    # metrics of the first font, the others only fill in missing glyphs.
+    metrics = faces[0].size
+    font.advance_y = metrics.height >> 6
+    font.ascender = metrics.ascender >> 6
+    font.descender = metrics.descender >> 6
+
+    available = []
+    bitmap = bytearray()
+    for cp in sorted(code_points):
+        face = next((f for f in faces if f.get_char_index(cp) != 0), None)
+        if face is None:
+            if args.verbose:
+                print("no glyph for U+%04X" % cp, file=sys.stderr)
+            continue
+        face.load_char(cp, freetype.FT_LOAD_RENDER | freetype.FT_LOAD_TARGET_NORMAL)
+        glyph = face.glyph
+        data = quantize(glyph.bitmap)
+        stored = zlib.compress(data, 9) if args.compress else data
+        if len(stored) > 0xFFFF:
+            sys.exit("glyph U+%04X is too large" % cp)
+        if glyph.bitmap.width > 255 or glyph.bitmap.rows > 255:
+            sys.exit("glyph U+%04X exceeds 255 pixels" % cp)
+        font.glyphs.append((
+            glyph.bitmap.width,
+            glyph.bitmap.rows,
+            min(255, glyph.advance.x >> 6),
+            glyph.bitmap_left,
+            glyph.bitmap_top,
+            len(stored) if args.compress else 0,
+            len(bitmap),
+            len(data),
+            cp,
+        ))
+        bitmap += stored
+        available.append(cp)
+
+    offset = 0
+    for first, last in merge_intervals(available):
+        font.intervals.append((first, last, offset))
+        offset += last - first + 1
+    font.bitmap = bytes(bitmap)
+    return font
+
+
+def print_stats(font, requested):
+    raw = sum(g[7] for g in font.glyphs)
+    intervals = len(font.intervals)
+    direct = sum(1 for g in font.glyphs if g[8] < DIRECT_CPS)
+    steps = math.ceil(math.log2(intervals + 1)) if intervals else 0
+    out = sys.stderr
+    print("%s %d: %d of %d code points, %d intervals" % (
+        font.name, font.size, len(font.glyphs), requested, intervals), file=out)
+    print("  bitmaps  %d bytes, %d uncompressed (%.0f%%)" % (
+        len(font.bitmap), raw, 100.0 * len(font.bitmap) / raw if raw else 0),
+        file=out)
+    print("  tables   %d bytes of glyphs, %d bytes of intervals" % (
+        len(font.glyphs) * GLYPH.size, intervals * INTERVAL.size), file=out)
+    print("  lookup   %d glyphs direct, others at most %d interval probes" % (
+        direct, steps), file=out)
+
+
+def write_header(font, out):
+    name = font.name
+    out.write("#pragma once\n#include \"epd_driver.h\"\n\n")
+    out.write("const uint8_t %sBitmaps[%d] = {\n" % (name, len(font.bitmap)))
+    for i in range(0, len(font.bitmap), 16):
+        chunk = font.bitmap[i:i + 16]
+        out.write("    " + " ".join("0x%02X," % b for b in chunk) + "\n")
+    out.write("};\n\n")
+
+    out.write("const GFXglyph %sGlyphs[] = {\n" % name)
+    for g in font.glyphs:
+        cp = g[8]
+        label = chr(cp) if 0x20 < cp < 0x7F and chr(cp) not in "\\'" else "U+%04X" % cp
+        out.write("    { %d, %d, %d, %d, %d, %d, %d }, // %s\n" % (g[:7] + (label,)))
+    out.write("};\n\n")
+
+    out.write("const UnicodeInterval %sIntervals[] = {\n" % name)
+    for first, last, offset in font.intervals:
+        out.write("    { 0x%X, 0x%X, 0x%X },\n" % (first, last, offset))
+    out.write("};\n\n")
+
+    out.write("const GFXfont %s = {\n" % name)
+    out.write("    (uint8_t *)%sBitmaps,\n" % name)
+    out.write("    (GFXglyph *)%sGlyphs,\n" % name)
+    out.write("    (UnicodeInterval *)%sIntervals,\n" % name)
+    out.write("    %d,\n" % len(font.intervals))
+    out.write("    %d,\n" % int(font.compressed))
+    out.write("    %d,\n" % font.advance_y)
+    out.write("    %d,\n" % font.ascender)
+    out.write("    %d,\n" % font.descender)
+    out.write("};\n")
+
+
+def align4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def read_pack(path):
+    """The fonts of an existing pack, as serialized tables."""
+    with open(path, "rb") as f:
+        pack = f.read()
+    magic, version, count, size, _ = HEADER.unpack_from(pack, 0)
+    if magic != FONT_PACK_MAGIC or version != FONT_PACK_VERSION or size > len(pack):
+        sys.exit("%s is no version %d font pack" % (path, FONT_PACK_VERSION))
+    fonts = []
+    for i in range(count):
+        e = ENTRY.unpack_from(pack, HEADER.size + i * ENTRY.size)
+        (name, size_pt, compressed, advance_y, ascender, descender,
+         interval_offset, interval_count, glyph_offset, glyph_count,
+         bitmap_offset, bitmap_size) = e
+        fonts.append({
+            "name": name.rstrip(b"\0"),
+            "size": size_pt,
+            "meta": (compressed, advance_y, ascender, descender),
+            "intervals": pack[interval_offset:interval_offset + interval_count * INTERVAL.size],
+            "interval_count": interval_count,
+            "glyphs": pack[glyph_offset:glyph_offset + glyph_count * GLYPH.size],
+            "glyph_count": glyph_count,
+            "bitmap": pack[bitmap_offset:bitmap_offset + bitmap_size],
+        })
+    return fonts
+
+
+def serialize(font):
+    name = font.name.encode()
+    if len(name) >= FONT_PACK_NAME_LEN:
+        sys.exit("font name %s is too long" % font.name)
+    return {
+        "name": name,
+        "size": font.size,
+        "meta": (int(font.compressed), font.advance_y, font.ascender, font.descender),
+        "intervals": b"".join(INTERVAL.pack(*i) for i in font.intervals),
+        "interval_count": len(font.intervals),
+        "glyphs": b"".join(GLYPH.pack(*g[:7]) for g in font.glyphs),
+        "glyph_count": len(font.glyphs),
+        "bitmap": font.bitmap,
+    }
+
+
+def write_pack(font, path):
+    fonts = read_pack(path) if os.path.exists(path) else []
+    new = serialize(font)
+    fonts = [f for f in fonts if (f["name"], f["size"]) != (new["name"], new["size"])]
+    fonts.append(new)
+
+    entries = b""
+    tables = b""
+    base = HEADER.size + len(fonts) * ENTRY.size
+    for f in fonts:
+        interval_offset = base + len(tables)
+        tables = align4(tables + f["intervals"])
+        glyph_offset = base + len(tables)
+        tables = align4(tables + f["glyphs"])
+        bitmap_offset = base + len(tables)
+        tables = align4(tables + f["bitmap"])
+        entries += ENTRY.pack(f["name"], f["size"], *f["meta"],
+                              interval_offset, f["interval_count"],
+                              glyph_offset, f["glyph_count"],
+                              bitmap_offset, len(f["bitmap"]))
+
+    size = base + len(tables)
+    header = HEADER.pack(FONT_PACK_MAGIC, FONT_PACK_VERSION, len(fonts), size, 0)
+    with open(path, "wb") as f:
+        f.write(header + entries + tables)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("name", help="C identifier and pack name of the font")
+    parser.add_argument("size", type=int, help="font size in points")
+    parser.add_argument("fonts", nargs="+",
+                        help="font files, later ones only fill in missing glyphs")
+    parser.add_argument("--range", dest="ranges", action="append", type=parse_range,
+                        help="code points as FIRST-LAST, a single code point or one "
+                             "of %s (default ascii, repeatable)" % ", ".join(RANGES))
+    parser.add_argument("--dpi", type=int, default=150, help="render resolution")
+    parser.add_argument("--compress", action="store_true",
+                        help="zlib compress the glyph bitmaps")
+    parser.add_argument("--pack", metavar="FILE",
+                        help="add the font to a font pack instead of writing a header")
+    parser.add_argument("--stats", action="store_true",
+                        help="report sizes and lookup cost on stderr")
+    parser.add_argument("--verbose", action="store_true",
+                        help="list requested code points without glyph")
+    args = parser.parse_args()
+
+    code_points = set()
+    for ranges in args.ranges or [RANGES["ascii"]]:
+        for first, last in ranges:
+            code_points.update(range(first, last + 1))
+
+    font = compile_font(args, code_points)
+    if args.stats:
+        print_stats(font, len(code_points))
+    if args.pack:
+        write_pack(font, args.pack)
+    else:
+        write_header(font, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
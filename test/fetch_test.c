@@ -0,0 +1,324 @@
+/**
+ * Host test of the page fetcher against the stub site of http_stub.c.
+ *
+ * Checks the requests each kind of poll takes, through the fetcher counters
+ * and the requests the site received.
+ *
+ * Usage: fetch_test
+ */
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "fetch.h"
+#include "http_stub.h"
+
+#include <freertos/task.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Check a condition, print it and fail the test if it does not hold.
+ */
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            printf("%s:%d: %s\n", __func__, __LINE__, #condition);             \
+            return false;                                                      \
+        }                                                                      \
+    } while (0)
+
+#define ATTEMPTS 4
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief A fetcher with its session.
+ */
+typedef struct
+{
+    fetch_t fetch;
+    fetch_session_t session;
+} fixture_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Accepts a page body that holds a table.
+ */
+static bool on_body(fetch_body_event_t event, const char *data, size_t length,
+                    void *arg);
+
+/**
+ * @brief Reset the site and create a fetcher with a new session.
+ */
+static bool setup(fixture_t *fixture, uint32_t attempts);
+
+/**
+ * @brief Poll, and get the counter changes of the poll.
+ */
+static esp_err_t poll_once(fixture_t *fixture, fetch_result_t *result,
+                           fetch_stats_t *delta);
+
+static bool test_first_poll(void);
+static bool test_not_modified(void);
+static bool test_expired_session(int reject_status);
+static bool test_rejected_login(void);
+static bool test_transport_retries(void);
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static bool page_has_table;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+int main(void)
+{
+    bool ok = test_first_poll();
+    ok = test_not_modified() && ok;
+    ok = test_expired_session(302) && ok;
+    ok = test_expired_session(401) && ok;
+    ok = test_rejected_login() && ok;
+    ok = test_transport_retries() && ok;
+
+    printf("%s\n", ok ? "all passed" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static bool on_body(fetch_body_event_t event, const char *data, size_t length,
+                    void *arg)
+{
+    (void)arg;
+    switch (event)
+    {
+    case FETCH_BODY_BEGIN:
+        page_has_table = false;
+        break;
+    case FETCH_BODY_DATA:
+        page_has_table |= length >= 7 && strncmp(data, "<table>", 7) == 0;
+        break;
+    case FETCH_BODY_END:
+        return page_has_table;
+    }
+    return true;
+}
+
+
+static bool setup(fixture_t *fixture, uint32_t attempts)
+{
+    static const fetch_config_t config = {
+        .page_url = "https://site/rodic/index.php",
+        .login_url = "https://site" HTTP_STUB_LOGIN_PATH "?a=3",
+        .login_body = "username=user&password=secret",
+        .cookie_name = HTTP_STUB_COOKIE,
+        .on_body = on_body,
+        .backoff_ms = 100,
+        .backoff_max_ms = 1000,
+    };
+
+    http_stub_reset();
+    memset(fixture, 0, sizeof(fixture_t));
+    fetch_config_t with_attempts = config;
+    with_attempts.attempts = attempts;
+    return fetch_init(&fixture->fetch, &with_attempts, &fixture->session) ==
+           ESP_OK;
+}
+
+
+static esp_err_t poll_once(fixture_t *fixture, fetch_result_t *result,
+                           fetch_stats_t *delta)
+{
+    fetch_stats_t before, after;
+    fetch_get_stats(&fixture->fetch, &before);
+    http_stub_clear_counts();
+    esp_err_t err = fetch_poll(&fixture->fetch, result);
+    fetch_get_stats(&fixture->fetch, &after);
+
+    delta->polls = after.polls - before.polls;
+    delta->requests = after.requests - before.requests;
+    delta->logins = after.logins - before.logins;
+    delta->not_modified = after.not_modified - before.not_modified;
+    delta->retries = after.retries - before.retries;
+    delta->last_requests = after.last_requests;
+    return err;
+}
+
+
+static bool test_first_poll(void)
+{
+    fixture_t fixture;
+    CHECK(setup(&fixture, ATTEMPTS));
+
+    // the login form, the credentials and the page.
+    fetch_result_t result;
+    fetch_stats_t delta;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    CHECK(result == FETCH_CHANGED);
+    CHECK(delta.requests == 3);
+    CHECK(delta.last_requests == 3);
+    CHECK(delta.logins == 1);
+    CHECK(delta.not_modified == 0);
+    CHECK(delta.retries == 0);
+    CHECK(http_stub_site.requests == 3);
+    CHECK(http_stub_site.form_requests == 1);
+    CHECK(http_stub_site.posts == 1);
+    CHECK(fixture.session.cookie[0] != '\0');
+    CHECK(strcmp(fixture.session.etag, "\"v1\"") == 0);
+
+    fetch_deinit(&fixture.fetch);
+    printf("first poll: ok\n");
+    return true;
+}
+
+
+static bool test_not_modified(void)
+{
+    fixture_t fixture;
+    fetch_result_t result;
+    fetch_stats_t delta;
+    CHECK(setup(&fixture, ATTEMPTS));
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+
+    // the session and the ETag are reused, one conditional request.
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    CHECK(result == FETCH_NOT_MODIFIED);
+    CHECK(delta.requests == 1);
+    CHECK(delta.logins == 0);
+    CHECK(delta.not_modified == 1);
+    CHECK(delta.retries == 0);
+    CHECK(http_stub_site.requests == 1);
+
+    // a changed page is received in one request as well.
+    http_stub_site.page_version++;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    CHECK(result == FETCH_CHANGED);
+    CHECK(delta.requests == 1);
+    CHECK(delta.not_modified == 0);
+    CHECK(strcmp(fixture.session.etag, "\"v2\"") == 0);
+
+    fetch_deinit(&fixture.fetch);
+    printf("not modified: ok\n");
+    return true;
+}
+
+
+static bool test_expired_session(int reject_status)
+{
+    fixture_t fixture;
+    fetch_result_t result;
+    fetch_stats_t delta;
+
+    // a single attempt, so a login that counted as one would fail the poll.
+    CHECK(setup(&fixture, 1));
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    http_stub_site.reject_status = reject_status;
+    http_stub_expire_session();
+
+    // the rejected page, the login form, the credentials and the page.
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    CHECK(result == FETCH_CHANGED);
+    CHECK(delta.requests == 4);
+    CHECK(delta.logins == 1);
+    CHECK(delta.not_modified == 0);
+    CHECK(delta.retries == 0);
+    CHECK(http_stub_site.page_requests == 2);
+    CHECK(http_stub_site.form_requests == 1);
+    CHECK(http_stub_site.posts == 1);
+    CHECK(fixture.session.failures == 0);
+
+    fetch_deinit(&fixture.fetch);
+    printf("expired session %d: ok\n", reject_status);
+    return true;
+}
+
+
+static bool test_rejected_login(void)
+{
+    fixture_t fixture;
+    fetch_result_t result;
+    fetch_stats_t delta;
+
+    // the page is the login form even after logging in.
+    CHECK(setup(&fixture, ATTEMPTS));
+    http_stub_site.serve_login_form = true;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_ERR_NOT_FOUND);
+    CHECK(delta.requests == 3);
+    CHECK(delta.logins == 1);
+    CHECK(delta.retries == 0);
+    CHECK(http_stub_site.requests == 3);
+    CHECK(fixture.session.cookie[0] == '\0');
+    CHECK(fixture.session.failures == 1);
+
+    // with an old session, one login and then the same.
+    http_stub_site.serve_login_form = false;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    http_stub_site.serve_login_form = true;
+    http_stub_site.page_version++;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_ERR_NOT_FOUND);
+    CHECK(delta.requests == 4);
+    CHECK(delta.logins == 1);
+    CHECK(delta.retries == 0);
+
+    fetch_deinit(&fixture.fetch);
+    printf("rejected login: ok\n");
+    return true;
+}
+
+
+static bool test_transport_retries(void)
+{
+    fixture_t fixture;
+    fetch_result_t result;
+    fetch_stats_t delta;
+    CHECK(setup(&fixture, ATTEMPTS));
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+
+    // two failures, then the page.
+    http_stub_site.fail_next = 2;
+    host_task_delayed = 0;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_OK);
+    CHECK(result == FETCH_NOT_MODIFIED);
+    CHECK(delta.requests == 3);
+    CHECK(delta.retries == 2);
+    CHECK(delta.logins == 0);
+    CHECK(host_task_delayed > 0);
+
+    // the site is down, the attempts run out.
+    http_stub_site.fail_next = 100;
+    CHECK(poll_once(&fixture, &result, &delta) == ESP_FAIL);
+    CHECK(delta.requests == ATTEMPTS);
+    CHECK(delta.retries == ATTEMPTS - 1);
+    CHECK(fixture.session.failures == 1);
+    CHECK(fetch_retry_delay_ms(&fixture.fetch, 60000) == 100);
+
+    fetch_deinit(&fixture.fetch);
+    printf("transport retries: ok\n");
+    return true;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
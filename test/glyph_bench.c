@@ -0,0 +1,320 @@
+/**
+ * Host benchmark of the glyph lookup.
+ *
+ * Looks up the code points of ASCII, Czech and mixed Czech, punctuation and
+ * emoji text three ways: with the linear interval scan get_glyph used to do,
+ * with the binary search of fonts without an index, and with get_glyph on an
+ * indexed font (the direct table below U+0100 and the code point cache).
+ *
+ * The generated FiraSans header is not in the tree. The font has the interval
+ * table FiraSans was generated with instead: the default ranges of the epdiy
+ * font converter plus Latin Extended-A. The lookup does not touch bitmaps, so
+ * the glyphs are empty. The host numbers only compare the three, they are no
+ * ESP32 figures.
+ *
+ * Usage: glyph_bench [rounds]
+ */
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "arena.h"
+#include "epd_driver.h"
+#include "glyph_cache.h"
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define DEFAULT_ROUNDS 20000
+#define MAX_CODE_POINTS 256
+
+/**
+ * @brief Fonts that fill the index slots, so the next font is not indexed.
+ *        The Makefile sets the slot count of font.c.
+ */
+#define FILLER_FONTS (FONT_INDEX_MAX_FONTS - 1)
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    const char *name;
+    const char *text;
+} bench_text_t;
+
+/**
+ * @brief A glyph lookup to measure.
+ */
+typedef GFXglyph *(*lookup_t)(const GFXfont *font, uint32_t code_point);
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Build a font with the FiraSans intervals and empty glyphs.
+ */
+static void build_font(GFXfont *font);
+
+/**
+ * @brief The lookup of get_glyph before the index, a scan of the intervals.
+ */
+static GFXglyph *linear_lookup(const GFXfont *font, uint32_t code_point);
+
+static GFXglyph *indexed_lookup(const GFXfont *font, uint32_t code_point);
+
+/**
+ * @brief Time the lookups of some code points.
+ *
+ * @return Nanoseconds per lookup.
+ */
+static double measure(lookup_t lookup, const GFXfont *font,
+                      const uint32_t *code_points, uint32_t count,
+                      uint32_t rounds);
+
+static double seconds(void);
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/**
+ * @brief Ranges of the FiraSans header.
+ */
+static const uint32_t fira_ranges[][2] = {
+    {0x20, 0x7E},       /* Basic Latin */
+    {0xA0, 0xFF},       /* Latin-1 Supplement */
+    {0x100, 0x17F},     /* Latin Extended-A */
+    {0x2010, 0x205F},   /* General Punctuation */
+    {0x2190, 0x21FF},   /* Arrows */
+    {0x2200, 0x22FF},   /* Mathematical Operators */
+    {0x2300, 0x23FF},   /* Miscellaneous Technical */
+    {0x2500, 0x259F},   /* Box Drawing, Block Elements */
+    {0x25A0, 0x25FF},   /* Geometric Shapes */
+    {0x2600, 0x26F0},   /* Miscellaneous Symbols */
+    {0x2700, 0x27BF},   /* Dingbats */
+    {0xE0A0, 0xE0A2},   /* Powerline */
+    {0xE0B0, 0xE0B3},   /* Powerline */
+    {0x1F600, 0x1F680}, /* Emoticons */
+};
+
+/**
+ * @brief Sum of the looked up glyphs, keeps the lookups from being optimized
+ *        away.
+ */
+static volatile uintptr_t checksum;
+
+static const bench_text_t texts[] = {
+    {"ascii", "Page 3, exercises 1 to 4 and the reading for Monday."},
+    {"czech", "Str\xc3\xa1nka 3, cvi\xc4\x8d" "en\xc3\xad 1 a\xc5\xbe 4 a "
+              "\xc4\x8d" "ten\xc3\xad na pond\xc4\x9b" "l\xc3\xad."},
+    {"mixed", "\xe2\x80\x9e\xc3\x9akol\xe2\x80\x9c \xe2\x80\x93 "
+              "p\xc5\x99\xc3\xad\xc5\xa1t\xc3\xad t\xc3\xbd" "den "
+              "\xe2\x86\x92 \xc4\x8dt\xe2\x80\xa6 \xf0\x9f\x98\x80 "
+              "\xe2\x9c\x93 \xf0\x9f\x98\x8a \xe2\x98\x85"},
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_ROUNDS;
+    if (rounds == 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    // the first fonts get an index, the last one is binary searched.
+    static GFXfont indexed, fillers[FILLER_FONTS], searched;
+    GFXglyph *glyph;
+    build_font(&indexed);
+    get_glyph(&indexed, 'a', &glyph);
+    for (uint32_t i = 0; i < FILLER_FONTS; i++)
+    {
+        build_font(&fillers[i]);
+        get_glyph(&fillers[i], 'a', &glyph);
+    }
+    build_font(&searched);
+
+    printf("%u intervals\n", indexed.interval_count);
+    printf("%-8s %12s %12s %12s\n", "text", "linear ns", "binary ns",
+           "indexed ns");
+    for (size_t t = 0; t < sizeof(texts) / sizeof(texts[0]); t++)
+    {
+        uint32_t code_points[MAX_CODE_POINTS];
+        uint32_t count = 0;
+        const char *p = texts[t].text;
+        uint32_t cp;
+        while ((cp = utf8_next(&p)) != 0 && count < MAX_CODE_POINTS)
+        {
+            code_points[count++] = cp;
+        }
+
+        // the lookups must agree, glyphs are compared by index.
+        for (uint32_t i = 0; i < count; i++)
+        {
+            GFXglyph *linear = linear_lookup(&indexed, code_points[i]);
+            GFXglyph *binary = indexed_lookup(&searched, code_points[i]);
+            GFXglyph *cached = indexed_lookup(&indexed, code_points[i]);
+            ptrdiff_t n = cached - indexed.glyph;
+            if (linear == NULL || linear - indexed.glyph != n ||
+                binary - searched.glyph != n)
+            {
+                printf("%s: lookups of U+%04X disagree\n", texts[t].name,
+                       code_points[i]);
+                return EXIT_FAILURE;
+            }
+        }
+
+        printf("%-8s %12.2f %12.2f %12.2f\n", texts[t].name,
+               measure(linear_lookup, &indexed, code_points, count, rounds),
+               measure(indexed_lookup, &searched, code_points, count, rounds),
+               measure(indexed_lookup, &indexed, code_points, count, rounds));
+    }
+    return EXIT_SUCCESS;
+}
+
+/******************************************************************************/
+/***        stand-ins of the drawing code, font.c links against them        ***/
+/******************************************************************************/
+
+const uint8_t *glyph_cache_get(const GFXfont *font, const GFXglyph *glyph)
+{
+    return &font->bitmap[glyph->data_offset];
+}
+
+
+void glyph_cache_clear()
+{
+}
+
+
+void epd_draw_image(Rect_t area, uint8_t *data, DrawMode_t mode)
+{
+    (void)area;
+    (void)data;
+    (void)mode;
+}
+
+
+Rect_t epd_full_screen()
+{
+    return (Rect_t){.x = 0, .y = 0, .width = EPD_WIDTH, .height = EPD_HEIGHT};
+}
+
+
+void *arena_scratch_alloc(size_t size)
+{
+    return malloc(size);
+}
+
+
+void arena_scratch_free(void *ptr)
+{
+    free(ptr);
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static void build_font(GFXfont *font)
+{
+    static uint8_t bitmap[1];
+    const uint32_t ranges = sizeof(fira_ranges) / sizeof(fira_ranges[0]);
+    UnicodeInterval *intervals = calloc(ranges, sizeof(UnicodeInterval));
+    uint32_t glyphs = 0;
+    for (uint32_t i = 0; i < ranges; i++)
+    {
+        intervals[i].first = fira_ranges[i][0];
+        intervals[i].last = fira_ranges[i][1];
+        intervals[i].offset = glyphs;
+        glyphs += fira_ranges[i][1] - fira_ranges[i][0] + 1;
+    }
+
+    *font = (GFXfont){
+        .bitmap = bitmap,
+        .glyph = calloc(glyphs, sizeof(GFXglyph)),
+        .intervals = intervals,
+        .interval_count = ranges,
+        .advance_y = 50,
+        .ascender = 39,
+        .descender = -11,
+    };
+}
+
+
+static GFXglyph *linear_lookup(const GFXfont *font, uint32_t code_point)
+{
+    UnicodeInterval *intervals = font->intervals;
+    for (uint32_t i = 0; i < font->interval_count; i++)
+    {
+        UnicodeInterval *interval = &intervals[i];
+        if (code_point >= interval->first && code_point <= interval->last)
+        {
+            return &font->glyph[interval->offset +
+                                (code_point - interval->first)];
+        }
+        if (code_point < interval->first)
+        {
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+
+static GFXglyph *indexed_lookup(const GFXfont *font, uint32_t code_point)
+{
+    GFXglyph *glyph;
+    get_glyph(font, code_point, &glyph);
+    return glyph;
+}
+
+
+// not specialized for a lookup, each is an out of line call as get_glyph is.
+__attribute__((noipa))
+static double measure(lookup_t lookup, const GFXfont *font,
+                      const uint32_t *code_points, uint32_t count,
+                      uint32_t rounds)
+{
+    uintptr_t sum = 0;
+    double start = seconds();
+    for (uint32_t r = 0; r < rounds; r++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            sum += (uintptr_t)lookup(font, code_points[i]);
+        }
+    }
+    double elapsed = seconds() - start;
+    checksum = sum;
+    return elapsed * 1e9 / ((double)rounds * count);
+}
+
+
+static double seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,12 @@
+/**
+ * Host stand-in of the ESP-IDF assertions, for the host tests only.
+ */
+
+#ifndef _HOST_ESP_ASSERT_H_
+#define _HOST_ESP_ASSERT_H_
+
+#include <assert.h>
+
+#define ESP_STATIC_ASSERT _Static_assert
+
+#endif
@@ -0,0 +1,14 @@
+/**
+ * Host stand-in of the ESP-IDF memory placement attributes, for the host
+ * tests only.
+ */
+
+#ifndef _HOST_ESP_ATTR_H_
+#define _HOST_ESP_ATTR_H_
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define EXT_RAM_BSS_ATTR
+
+#endif
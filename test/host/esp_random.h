@@ -0,0 +1,16 @@
+/**
+ * Host stand-in of the ESP-IDF random numbers, for the host tests only.
+ */
+
+#ifndef _HOST_ESP_RANDOM_H_
+#define _HOST_ESP_RANDOM_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+
+static inline uint32_t esp_random(void)
+{
+    return (uint32_t)rand();
+}
+
+#endif
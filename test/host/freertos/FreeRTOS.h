@@ -0,0 +1,14 @@
+/**
+ * Host stand-in of FreeRTOS, for the host tests only.
+ */
+
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
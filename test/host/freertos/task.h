@@ -0,0 +1,20 @@
+/**
+ * Host stand-in of the FreeRTOS tasks, for the host tests only.
+ */
+
+#ifndef _HOST_FREERTOS_TASK_H_
+#define _HOST_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Ticks waited in total, the tests do not sleep.
+ */
+extern TickType_t host_task_delayed;
+
+static inline void vTaskDelay(TickType_t ticks)
+{
+    host_task_delayed += ticks;
+}
+
+#endif
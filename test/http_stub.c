@@ -0,0 +1,306 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "http_stub.h"
+
+#include <esp_http_client.h>
+#include <freertos/task.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define URL_MAX 256
+#define HEADER_MAX 128
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief The client, with the request it is set up for.
+ */
+struct esp_http_client
+{
+    esp_http_client_config_t config;
+    char url[URL_MAX];
+    esp_http_client_method_t method;
+    char cookie[HEADER_MAX];
+    char if_none_match[HEADER_MAX];
+    const char *post;
+    int status;
+};
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Pass a response header to the event handler.
+ */
+static void send_header(esp_http_client_handle_t client, const char *key,
+                        const char *value);
+
+/**
+ * @brief Pass a chunk of the response body to the event handler.
+ */
+static void send_data(esp_http_client_handle_t client, const char *data);
+
+/**
+ * @brief Check if the request carries the cookie of the current session.
+ */
+static bool has_session(esp_http_client_handle_t client);
+
+static void serve_login(esp_http_client_handle_t client);
+static void serve_page(esp_http_client_handle_t client);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+http_stub_site_t http_stub_site;
+TickType_t host_task_delayed;
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/**
+ * @brief The client, the fetcher uses one at a time.
+ */
+static struct esp_http_client the_client;
+
+static uint32_t session_id;
+static char session_cookie[HEADER_MAX];
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void http_stub_reset(void)
+{
+    memset(&http_stub_site, 0, sizeof(http_stub_site));
+    http_stub_site.page_version = 1;
+    http_stub_site.reject_status = 302;
+    session_cookie[0] = '\0';
+}
+
+
+void http_stub_clear_counts(void)
+{
+    http_stub_site.requests = 0;
+    http_stub_site.form_requests = 0;
+    http_stub_site.posts = 0;
+    http_stub_site.page_requests = 0;
+}
+
+
+void http_stub_expire_session(void)
+{
+    http_stub_site.logged_in = false;
+    session_cookie[0] = '\0';
+}
+
+
+esp_http_client_handle_t esp_http_client_init(
+    const esp_http_client_config_t *config)
+{
+    esp_http_client_handle_t client = &the_client;
+    memset(client, 0, sizeof(struct esp_http_client));
+    client->config = *config;
+    snprintf(client->url, sizeof(client->url), "%s", config->url);
+    return client;
+}
+
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
+{
+    http_stub_site.requests++;
+    if (http_stub_site.fail_next > 0)
+    {
+        http_stub_site.fail_next--;
+        return ESP_FAIL;
+    }
+
+    if (strstr(client->url, HTTP_STUB_LOGIN_PATH) != NULL)
+    {
+        serve_login(client);
+    }
+    else
+    {
+        serve_page(client);
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client,
+                                  const char *url)
+{
+    snprintf(client->url, sizeof(client->url), "%s", url);
+    return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client,
+                                     esp_http_client_method_t method)
+{
+    client->method = method;
+    return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client,
+                                     const char *key, const char *value)
+{
+    if (strcmp(key, "Cookie") == 0)
+    {
+        snprintf(client->cookie, sizeof(client->cookie), "%s", value);
+    }
+    else if (strcmp(key, "If-None-Match") == 0)
+    {
+        snprintf(client->if_none_match, sizeof(client->if_none_match), "%s",
+                 value);
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client,
+                                        const char *key)
+{
+    if (strcmp(key, "Cookie") == 0)
+    {
+        client->cookie[0] = '\0';
+    }
+    else if (strcmp(key, "If-None-Match") == 0)
+    {
+        client->if_none_match[0] = '\0';
+    }
+    return ESP_OK;
+}
+
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client,
+                                         const char *data, int len)
+{
+    client->post = len > 0 ? data : NULL;
+    return ESP_OK;
+}
+
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    return client->status;
+}
+
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    memset(client, 0, sizeof(struct esp_http_client));
+    return ESP_OK;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static void send_header(esp_http_client_handle_t client, const char *key,
+                        const char *value)
+{
+    esp_http_client_event_t evt = {
+        .event_id = HTTP_EVENT_ON_HEADER,
+        .client = client,
+        .user_data = client->config.user_data,
+        .header_key = (char *)key,
+        .header_value = (char *)value,
+    };
+    client->config.event_handler(&evt);
+}
+
+
+static void send_data(esp_http_client_handle_t client, const char *data)
+{
+    esp_http_client_event_t evt = {
+        .event_id = HTTP_EVENT_ON_DATA,
+        .client = client,
+        .user_data = client->config.user_data,
+        .data = (void *)data,
+        .data_len = (int)strlen(data),
+    };
+    client->config.event_handler(&evt);
+}
+
+
+static bool has_session(esp_http_client_handle_t client)
+{
+    return session_cookie[0] != '\0' &&
+           strcmp(client->cookie, session_cookie) == 0;
+}
+
+
+static void serve_login(esp_http_client_handle_t client)
+{
+    if (client->method == HTTP_METHOD_GET)
+    {
+        // every form starts a new session.
+        http_stub_site.form_requests++;
+        http_stub_site.logged_in = false;
+        snprintf(session_cookie, sizeof(session_cookie), "%s=s%u",
+                 HTTP_STUB_COOKIE, ++session_id);
+        char set_cookie[HEADER_MAX + 16];
+        snprintf(set_cookie, sizeof(set_cookie), "%s; path=/", session_cookie);
+        client->status = 200;
+        send_header(client, "Set-Cookie", set_cookie);
+        send_data(client, "<form>");
+        return;
+    }
+
+    http_stub_site.posts++;
+    if (http_stub_site.reject_login || !has_session(client) ||
+        client->post == NULL)
+    {
+        client->status = 403;
+        return;
+    }
+    http_stub_site.logged_in = true;
+    client->status = 302;
+    send_header(client, "Location", "/rodic/index.php");
+}
+
+
+static void serve_page(esp_http_client_handle_t client)
+{
+    http_stub_site.page_requests++;
+    if (!has_session(client) || !http_stub_site.logged_in)
+    {
+        client->status = http_stub_site.reject_status;
+        if (client->status == 302)
+        {
+            send_header(client, "Location", HTTP_STUB_LOGIN_PATH);
+        }
+        return;
+    }
+
+    char etag[32];
+    snprintf(etag, sizeof(etag), "\"v%u\"", http_stub_site.page_version);
+    if (strcmp(client->if_none_match, etag) == 0)
+    {
+        client->status = 304;
+        send_header(client, "ETag", etag);
+        return;
+    }
+
+    client->status = 200;
+    send_header(client, "ETag", etag);
+    send_data(client, http_stub_site.serve_login_form ? "<form>" : "<table>");
+    send_data(client, "</table>");
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
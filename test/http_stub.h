@@ -0,0 +1,88 @@
+/**
+ * In-process stub of the polled site, for the host tests.
+ *
+ * Implements the ESP-IDF HTTP client API of test/host/esp_http_client.h and
+ * answers each request the way the school site does. A GET of the login URL
+ * starts a session and sets its cookie, a POST of the credentials with that
+ * cookie logs it in. The page needs a logged in session, otherwise it answers
+ * with `reject_status`. It has an ETag and answers a matching If-None-Match
+ * with 304.
+ *
+ * The test sets up the site through `http_stub_site` and reads the requests
+ * it received from there.
+ */
+
+#ifndef _HTTP_STUB_H_
+#define _HTTP_STUB_H_
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Name of the session cookie.
+ */
+#define HTTP_STUB_COOKIE "PHPSESSID"
+
+/**
+ * @brief Path part that marks the login URL.
+ */
+#define HTTP_STUB_LOGIN_PATH "/auth/"
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Behaviour and counters of the stub site.
+ */
+typedef struct
+{
+    uint32_t page_version;  /** Part of the page ETag, bump to change it */
+    int reject_status;      /** Page status without a session, 302 or 401 */
+    bool serve_login_form;  /** The page is the login form, with status 200 */
+    bool reject_login;      /** Credential posts answer 403 */
+    uint32_t fail_next;     /** Requests to fail in transport */
+    bool logged_in;         /** The current session is logged in */
+    uint32_t requests;      /** All requests, failed ones included */
+    uint32_t form_requests; /** GETs of the login form */
+    uint32_t posts;         /** Credential posts */
+    uint32_t page_requests;
+} http_stub_site_t;
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+extern http_stub_site_t http_stub_site;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+/**
+ * @brief Reset the site to a fresh state, without sessions.
+ */
+void http_stub_reset(void);
+
+/**
+ * @brief Clear the request counters.
+ */
+void http_stub_clear_counts(void);
+
+/**
+ * @brief End the current session on the site, as a timeout would.
+ */
+void http_stub_expire_session(void);
+
+#endif
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
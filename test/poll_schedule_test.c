@@ -0,0 +1,279 @@
+/**
+ * Host test of the poll schedule.
+ *
+ * Covers the RTC state checks and the decisions of the state machine, with
+ * the clock passed in by the test.
+ *
+ * Usage: poll_schedule_test
+ */
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "poll_schedule.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/**
+ * @brief Check a condition, print it and fail the test if it does not hold.
+ */
+#define CHECK(condition)                                                       \
+    do                                                                         \
+    {                                                                          \
+        if (!(condition))                                                      \
+        {                                                                      \
+            printf("%s:%d: %s\n", __func__, __LINE__, #condition);             \
+            return false;                                                      \
+        }                                                                      \
+    } while (0)
+
+#define MINUTE_MS (60 * 1000)
+#define START_MS (24 * 60 * MINUTE_MS)
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static bool test_valid(void);
+static bool test_stretch(void);
+static bool test_changed(void);
+static bool test_failed(void);
+static bool test_clock_back(void);
+static bool test_min_sleep(void);
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const poll_schedule_config_t config = {
+    .interval_ms = 15 * MINUTE_MS,
+    .max_interval_ms = 120 * MINUTE_MS,
+    .stretch_after = 3,
+    .min_sleep_ms = 5000,
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+int main(void)
+{
+    bool ok = test_valid();
+    ok = test_stretch() && ok;
+    ok = test_changed() && ok;
+    ok = test_failed() && ok;
+    ok = test_clock_back() && ok;
+    ok = test_min_sleep() && ok;
+
+    printf("%s\n", ok ? "all passed" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static bool test_valid(void)
+{
+    poll_schedule_t schedule;
+    poll_schedule_init(&schedule, &config, START_MS);
+    CHECK(poll_schedule_valid(&schedule));
+    CHECK(schedule.next_poll_ms == START_MS);
+    CHECK(schedule.interval_ms == config.interval_ms);
+
+    // a change that is sealed stays valid.
+    poll_schedule_update(&schedule, &config, START_MS, POLL_UNCHANGED, 0);
+    CHECK(!poll_schedule_valid(&schedule));
+    poll_schedule_seal(&schedule);
+    CHECK(poll_schedule_valid(&schedule));
+
+    // corrupt memory fails the checksum.
+    poll_schedule_t corrupt = schedule;
+    corrupt.interval_ms ^= 1;
+    CHECK(!poll_schedule_valid(&corrupt));
+    corrupt = schedule;
+    corrupt.checksum ^= 1;
+    CHECK(!poll_schedule_valid(&corrupt));
+
+    // another layout fails even with a matching checksum.
+    corrupt = schedule;
+    corrupt.version = POLL_SCHEDULE_VERSION + 1;
+    poll_schedule_seal(&corrupt);
+    CHECK(!poll_schedule_valid(&corrupt));
+    corrupt = schedule;
+    corrupt.magic = 0;
+    poll_schedule_seal(&corrupt);
+    CHECK(!poll_schedule_valid(&corrupt));
+
+    printf("valid: ok\n");
+    return true;
+}
+
+
+static bool test_stretch(void)
+{
+    poll_schedule_t schedule;
+    poll_schedule_init(&schedule, &config, START_MS);
+    uint64_t now = START_MS;
+
+    // the interval holds until stretch_after unchanged polls.
+    for (uint32_t i = 1; i < config.stretch_after; i++)
+    {
+        poll_schedule_update(&schedule, &config, now, POLL_UNCHANGED, 0);
+        CHECK(schedule.interval_ms == config.interval_ms);
+        CHECK(schedule.next_poll_ms == now + config.interval_ms);
+        now = schedule.next_poll_ms;
+    }
+
+    // then it doubles with every poll, up to the maximum.
+    uint32_t expected = config.interval_ms;
+    for (uint32_t i = 0; i < 6; i++)
+    {
+        poll_schedule_update(&schedule, &config, now, POLL_UNCHANGED, 0);
+        expected = expected * 2 < config.max_interval_ms
+                       ? expected * 2
+                       : config.max_interval_ms;
+        CHECK(schedule.interval_ms == expected);
+        CHECK(schedule.next_poll_ms == now + expected);
+        now = schedule.next_poll_ms;
+    }
+    CHECK(schedule.interval_ms == config.max_interval_ms);
+    CHECK(schedule.unchanged == config.stretch_after + 5);
+
+    printf("stretch: ok\n");
+    return true;
+}
+
+
+static bool test_changed(void)
+{
+    poll_schedule_t schedule;
+    poll_schedule_init(&schedule, &config, START_MS);
+    uint64_t now = START_MS;
+    for (uint32_t i = 0; i < config.stretch_after + 2; i++)
+    {
+        poll_schedule_update(&schedule, &config, now, POLL_UNCHANGED, 0);
+        now = schedule.next_poll_ms;
+    }
+    CHECK(schedule.interval_ms > config.interval_ms);
+
+    poll_schedule_update(&schedule, &config, now, POLL_CHANGED, 0);
+    CHECK(schedule.interval_ms == config.interval_ms);
+    CHECK(schedule.unchanged == 0);
+    CHECK(schedule.last_change_ms == now);
+    CHECK(schedule.next_poll_ms == now + config.interval_ms);
+
+    printf("changed: ok\n");
+    return true;
+}
+
+
+static bool test_failed(void)
+{
+    poll_schedule_t schedule;
+    poll_schedule_init(&schedule, &config, START_MS);
+    uint64_t now = START_MS;
+    for (uint32_t i = 0; i < config.stretch_after; i++)
+    {
+        poll_schedule_update(&schedule, &config, now, POLL_UNCHANGED, 0);
+        now = schedule.next_poll_ms;
+    }
+    uint32_t interval = schedule.interval_ms;
+    uint32_t unchanged = schedule.unchanged;
+
+    // a failure retries after the given delay and keeps the interval.
+    poll_schedule_update(&schedule, &config, now, POLL_FAILED, 30000);
+    CHECK(schedule.next_poll_ms == now + 30000);
+    CHECK(schedule.interval_ms == interval);
+    CHECK(schedule.unchanged == unchanged);
+    CHECK(schedule.failures == 1);
+
+    // without a delay, the base interval.
+    now = schedule.next_poll_ms;
+    poll_schedule_update(&schedule, &config, now, POLL_FAILED, 0);
+    CHECK(schedule.next_poll_ms == now + config.interval_ms);
+    CHECK(schedule.interval_ms == interval);
+    CHECK(schedule.failures == 2);
+
+    // a success clears the failures.
+    now = schedule.next_poll_ms;
+    poll_schedule_update(&schedule, &config, now, POLL_UNCHANGED, 0);
+    CHECK(schedule.failures == 0);
+
+    printf("failed: ok\n");
+    return true;
+}
+
+
+static bool test_clock_back(void)
+{
+    poll_schedule_t schedule;
+    poll_schedule_init(&schedule, &config, START_MS);
+    poll_schedule_update(&schedule, &config, START_MS, POLL_CHANGED, 0);
+
+    uint32_t sleep_ms = 0;
+    CHECK(poll_schedule_next(&schedule, &config, START_MS, &sleep_ms) ==
+          POLL_ACTION_SLEEP);
+    CHECK(sleep_ms == config.interval_ms);
+
+    // a due time beyond the longest interval means the clock went back.
+    uint64_t now = START_MS + config.interval_ms -
+                   config.max_interval_ms - 1;
+    CHECK(poll_schedule_next(&schedule, &config, now, &sleep_ms) ==
+          POLL_ACTION_POLL);
+    CHECK(schedule.next_poll_ms == now);
+
+    // exactly the longest interval ahead is still trusted.
+    poll_schedule_update(&schedule, &config, START_MS, POLL_CHANGED, 0);
+    now = schedule.next_poll_ms - config.max_interval_ms;
+    CHECK(poll_schedule_next(&schedule, &config, now, &sleep_ms) ==
+          POLL_ACTION_SLEEP);
+    CHECK(sleep_ms == config.max_interval_ms);
+
+    printf("clock back: ok\n");
+    return true;
+}
+
+
+static bool test_min_sleep(void)
+{
+    poll_schedule_t schedule;
+    poll_schedule_init(&schedule, &config, START_MS);
+    uint32_t sleep_ms = 0;
+
+    // due now.
+    CHECK(poll_schedule_next(&schedule, &config, START_MS, &sleep_ms) ==
+          POLL_ACTION_POLL);
+    CHECK(schedule.wakeups == 1);
+
+    // a wait shorter than min_sleep_ms is no deep sleep.
+    poll_schedule_update(&schedule, &config, START_MS, POLL_CHANGED, 0);
+    uint64_t now = schedule.next_poll_ms - (config.min_sleep_ms - 1);
+    CHECK(poll_schedule_next(&schedule, &config, now, &sleep_ms) ==
+          POLL_ACTION_POLL);
+    now = schedule.next_poll_ms - config.min_sleep_ms;
+    CHECK(poll_schedule_next(&schedule, &config, now, &sleep_ms) ==
+          POLL_ACTION_SLEEP);
+    CHECK(sleep_ms == config.min_sleep_ms);
+
+    // overdue.
+    now = schedule.next_poll_ms + MINUTE_MS;
+    CHECK(poll_schedule_remaining_ms(&schedule, now) == 0);
+    CHECK(poll_schedule_next(&schedule, &config, now, &sleep_ms) ==
+          POLL_ACTION_POLL);
+
+    printf("min sleep: ok\n");
+    return true;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
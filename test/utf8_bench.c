@@ -0,0 +1,209 @@
+/**
+ * Host benchmark of the UTF-8 decoder.
+ *
+ * Decodes a megabyte of ASCII, Czech and emoji text, with utf8_next alone and
+ * with the ASCII runs skipped by utf8_ascii_span as text_run_shape does. The
+ * host numbers only compare the two, they are no ESP32 figures.
+ *
+ * Usage: utf8_bench [rounds]
+ */
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define TEXT_SIZE (1024 * 1024)
+#define DEFAULT_ROUNDS 20
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    const char *name;
+    const char *sample; /** Repeated to fill the text */
+} bench_text_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Fill a buffer with copies of a sample, NUL terminated.
+ */
+static void fill_text(char *text, size_t size, const char *sample);
+
+/**
+ * @brief Decode a text with utf8_next only.
+ *
+ * @return A sum of the code points, so the loop is not optimized away.
+ */
+static uint32_t decode_next(const char *text);
+
+/**
+ * @brief Decode a text, passing its ASCII runs through.
+ */
+static uint32_t decode_span(const char *text);
+
+/**
+ * @brief Check that a text decodes without `UTF8_INVALID`.
+ */
+static bool valid_text(const char *text);
+
+static double seconds(void);
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const bench_text_t texts[] = {
+    {"ascii", "Page 3, exercises 1 to 4 and the reading for Monday. "},
+    {"czech", "Str\xc3\xa1nka 3, cvi\xc4\x8d" "en\xc3\xad 1 a\xc5\xbe 4 a "
+              "\xc4\x8d" "ten\xc3\xad na pond\xc4\x9b" "l\xc3\xad. "},
+    {"emoji", "\xf0\x9f\x98\x80\xf0\x9f\x93\x9a\xe2\x9c\x8f\xef\xb8\x8f "},
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_ROUNDS;
+    char *text = malloc(TEXT_SIZE + 1);
+    if (text == NULL || rounds == 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("%-8s %12s %12s\n", "text", "next MB/s", "span MB/s");
+    for (size_t t = 0; t < sizeof(texts) / sizeof(texts[0]); t++)
+    {
+        fill_text(text, TEXT_SIZE, texts[t].sample);
+        if (!valid_text(texts[t].sample))
+        {
+            printf("%s: the sample is no valid UTF-8\n", texts[t].name);
+            free(text);
+            return EXIT_FAILURE;
+        }
+
+        uint32_t sum_next = 0, sum_span = 0;
+        double start = seconds();
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            sum_next += decode_next(text);
+        }
+        double next_time = seconds() - start;
+
+        start = seconds();
+        for (uint32_t r = 0; r < rounds; r++)
+        {
+            sum_span += decode_span(text);
+        }
+        double span_time = seconds() - start;
+
+        if (sum_next != sum_span)
+        {
+            printf("%s: the decoders disagree\n", texts[t].name);
+            free(text);
+            return EXIT_FAILURE;
+        }
+        double megabytes = (double)TEXT_SIZE * rounds / (1024 * 1024);
+        printf("%-8s %12.1f %12.1f\n", texts[t].name, megabytes / next_time,
+               megabytes / span_time);
+    }
+
+    free(text);
+    return EXIT_SUCCESS;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static void fill_text(char *text, size_t size, const char *sample)
+{
+    size_t length = strlen(sample);
+    size_t n = 0;
+    // whole samples only, so no character is cut at the end.
+    while (n + length <= size)
+    {
+        memcpy(text + n, sample, length);
+        n += length;
+    }
+    text[n] = '\0';
+}
+
+
+static uint32_t decode_next(const char *text)
+{
+    uint32_t sum = 0;
+    uint32_t cp;
+    while ((cp = utf8_next(&text)) != 0)
+    {
+        sum += cp;
+    }
+    return sum;
+}
+
+
+static uint32_t decode_span(const char *text)
+{
+    uint32_t sum = 0;
+    for (;;)
+    {
+        uint32_t span = utf8_ascii_span(text, UINT32_MAX);
+        for (uint32_t i = 0; i < span; i++)
+        {
+            sum += (uint8_t)text[i];
+        }
+        text += span;
+
+        uint32_t cp = utf8_next(&text);
+        if (cp == 0)
+        {
+            return sum;
+        }
+        sum += cp;
+    }
+}
+
+
+static bool valid_text(const char *text)
+{
+    uint32_t cp;
+    while ((cp = utf8_next(&text)) != 0)
+    {
+        if (cp == UTF8_INVALID)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static double seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
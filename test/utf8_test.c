@@ -0,0 +1,352 @@
+/**
+ * Host test of the UTF-8 decoder.
+ *
+ * utf8_next is compared with a plain decoder written from table 3-7 of the
+ * Unicode standard, for all strings of up to three bytes and for random
+ * strings of interesting bytes. utf8_ascii_span is compared with a byte loop
+ * at all alignments, and utf8_encode is decoded back for all code points.
+ *
+ * Usage: utf8_test [iterations] [seed]
+ */
+
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "utf8.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+#define DEFAULT_ITERATIONS 1000000
+#define DEFAULT_SEED 1
+#define MAX_FUZZ_LENGTH 32
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Decode one code point of a NUL terminated string the plain way.
+ *
+ * @param length Set to the number of bytes consumed, 0 at the end.
+ */
+static uint32_t reference_next(const uint8_t *s, size_t *length);
+
+/**
+ * @brief Decode a whole string with both decoders and compare.
+ *
+ * @return false on a mismatch, which is printed.
+ */
+static bool check_string(const uint8_t *s, size_t length);
+
+static bool test_short_strings(void);
+static bool test_fuzz(uint32_t iterations);
+static bool test_ascii_span(uint32_t iterations);
+static bool test_encode(void);
+
+static uint32_t random_next(void);
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static uint32_t random_state;
+
+/**
+ * @brief Bytes the fuzzer builds strings from, the edges of the lead and
+ *        continuation byte ranges and some complete characters.
+ */
+static const char *fuzz_pieces[] = {
+    "a", "\n", "\x7f", "\x80", "\x8f", "\x90", "\x9f", "\xa0", "\xbf",
+    "\xc0", "\xc1", "\xc2", "\xdf", "\xe0", "\xe1", "\xec", "\xed", "\xee",
+    "\xef", "\xf0", "\xf1", "\xf3", "\xf4", "\xf5", "\xff",
+    "\xc5\x99",         /* U+0159 */
+    "\xe2\x82\xac",     /* U+20AC */
+    "\xed\x9f\xbf",     /* U+D7FF */
+    "\xef\xbf\xbd",     /* U+FFFD */
+    "\xf0\x9f\x98\x80", /* U+1F600 */
+    "\xf4\x8f\xbf\xbf", /* U+10FFFF */
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = argc > 1 ? strtoul(argv[1], NULL, 0)
+                                   : DEFAULT_ITERATIONS;
+    random_state = argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_SEED;
+    if (random_state == 0)
+    {
+        random_state = DEFAULT_SEED;
+    }
+
+    bool ok = test_short_strings();
+    ok = test_fuzz(iterations) && ok;
+    ok = test_ascii_span(iterations / 10) && ok;
+    ok = test_encode() && ok;
+
+    printf("%s\n", ok ? "all passed" : "FAILED");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static uint32_t reference_next(const uint8_t *s, size_t *length)
+{
+    uint8_t c = s[0];
+    if (c < 0x80)
+    {
+        *length = c != 0;
+        return c;
+    }
+
+    size_t need;
+    uint8_t low = 0x80, high = 0xBF;
+    uint32_t cp;
+    if (c >= 0xC2 && c <= 0xDF)
+    {
+        need = 2;
+        cp = c & 0x1F;
+    }
+    else if (c >= 0xE0 && c <= 0xEF)
+    {
+        need = 3;
+        cp = c & 0x0F;
+        low = c == 0xE0 ? 0xA0 : 0x80;
+        high = c == 0xED ? 0x9F : 0xBF;
+    }
+    else if (c >= 0xF0 && c <= 0xF4)
+    {
+        need = 4;
+        cp = c & 0x07;
+        low = c == 0xF0 ? 0x90 : 0x80;
+        high = c == 0xF4 ? 0x8F : 0xBF;
+    }
+    else
+    {
+        *length = 1;
+        return UTF8_INVALID;
+    }
+
+    // only the second byte has a narrowed range, NUL is in none of them.
+    for (size_t i = 1; i < need; i++)
+    {
+        if (s[i] < low || s[i] > high)
+        {
+            *length = i;
+            return UTF8_INVALID;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+        low = 0x80;
+        high = 0xBF;
+    }
+    *length = need;
+    return cp;
+}
+
+
+static bool check_string(const uint8_t *s, size_t length)
+{
+    const char *p = (const char *)s;
+    size_t offset = 0;
+
+    for (;;)
+    {
+        size_t expected_length;
+        uint32_t expected = reference_next(s + offset, &expected_length);
+        uint32_t cp = utf8_next(&p);
+        size_t advanced = (size_t)((const uint8_t *)p - s) - offset;
+
+        if (cp != expected || advanced != expected_length)
+        {
+            printf("mismatch at offset %zu of", offset);
+            for (size_t i = 0; i < length; i++)
+            {
+                printf(" %02x", s[i]);
+            }
+            printf(": got %08x/%zu, expected %08x/%zu\n", cp, advanced,
+                   expected, expected_length);
+            return false;
+        }
+        if (cp == 0)
+        {
+            return offset == length;
+        }
+        offset += advanced;
+    }
+}
+
+
+static bool test_short_strings(void)
+{
+    uint8_t s[4];
+    uint32_t count = 0;
+
+    // all strings of one to three non-NUL bytes.
+    for (uint32_t n = 1; n <= 3; n++)
+    {
+        uint32_t total = 1u << (8 * n);
+        for (uint32_t v = 0; v < total; v++)
+        {
+            bool has_nul = false;
+            for (uint32_t i = 0; i < n; i++)
+            {
+                s[i] = v >> (8 * i);
+                has_nul |= s[i] == 0;
+            }
+            if (has_nul)
+            {
+                continue;
+            }
+            s[n] = 0;
+            if (!check_string(s, n))
+            {
+                return false;
+            }
+            count++;
+        }
+    }
+    printf("short strings: %u ok\n", count);
+    return true;
+}
+
+
+static bool test_fuzz(uint32_t iterations)
+{
+    const uint32_t pieces = sizeof(fuzz_pieces) / sizeof(fuzz_pieces[0]);
+    uint8_t s[MAX_FUZZ_LENGTH + 1];
+
+    for (uint32_t n = 0; n < iterations; n++)
+    {
+        // strings end in a heap block of their own, so a read past the NUL
+        // shows up with the address sanitizer.
+        size_t length = 0;
+        uint32_t count = random_next() % 9;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const char *piece = fuzz_pieces[random_next() % pieces];
+            size_t piece_length = strlen(piece);
+            if (length + piece_length > MAX_FUZZ_LENGTH)
+            {
+                break;
+            }
+            memcpy(s + length, piece, piece_length);
+            length += piece_length;
+        }
+
+        uint8_t *copy = malloc(length + 1);
+        memcpy(copy, s, length);
+        copy[length] = 0;
+        bool ok = check_string(copy, length);
+        free(copy);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    printf("fuzz: %u ok\n", iterations);
+    return true;
+}
+
+
+static bool test_ascii_span(uint32_t iterations)
+{
+    uint8_t buffer[64 + 8];
+
+    for (uint32_t n = 0; n < iterations; n++)
+    {
+        size_t length = random_next() % 64;
+        for (size_t i = 0; i < sizeof(buffer); i++)
+        {
+            // mostly ASCII, so the runs get long enough for the word loop.
+            uint32_t r = random_next();
+            buffer[i] = (r & 0x700) ? 1 + r % 0x7F : r & 0xFF;
+        }
+
+        for (uint32_t offset = 0; offset < 8; offset++)
+        {
+            uint8_t *s = buffer + offset;
+            uint8_t saved = s[length];
+            s[length] = 0;
+            uint32_t max = random_next() % 72;
+
+            uint32_t expected = 0;
+            while (expected < max && s[expected] != 0 && s[expected] < 0x80)
+            {
+                expected++;
+            }
+            uint32_t span = utf8_ascii_span((const char *)s, max);
+            s[length] = saved;
+
+            if (span != expected)
+            {
+                printf("ascii span at offset %u, max %u: got %u, expected %u\n",
+                       offset, max, span, expected);
+                return false;
+            }
+        }
+    }
+    printf("ascii span: %u ok\n", iterations);
+    return true;
+}
+
+
+static bool test_encode(void)
+{
+    char s[UTF8_MAX_LENGTH + 1];
+
+    for (uint32_t cp = 1; cp <= 0x110000; cp++)
+    {
+        uint32_t length = utf8_encode(cp, s);
+        bool valid = cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+        if (!valid)
+        {
+            if (length != 0)
+            {
+                printf("encode U+%04X: got %u bytes for no code point\n", cp,
+                       length);
+                return false;
+            }
+            continue;
+        }
+
+        s[length] = 0;
+        const char *p = s;
+        uint32_t decoded = utf8_next(&p);
+        if (decoded != cp || (uint32_t)(p - s) != length)
+        {
+            printf("encode U+%04X: decoded as %08x from %u bytes\n", cp,
+                   decoded, length);
+            return false;
+        }
+    }
+    printf("encode: ok\n");
+    return true;
+}
+
+
+static uint32_t random_next(void)
+{
+    // xorshift32, the same strings for the same seed on every host.
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
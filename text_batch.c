@@ -0,0 +1,151 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "text_batch.h"
+#include "arena.h"
+
+#include <esp_log.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "text_batch";
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void text_batch_init(TextBatch *batch, TextBatchItem *storage,
+                     uint32_t capacity)
+{
+    batch->items = storage;
+    batch->capacity = capacity;
+    batch->count = 0;
+    batch->area.x = 0;
+    batch->area.y = 0;
+    batch->area.width = 0;
+    batch->area.height = 0;
+}
+
+
+bool text_batch_add_run(TextBatch *batch, const TextRun *run, int32_t x,
+                        int32_t y)
+{
+    if (batch->count == batch->capacity)
+    {
+        return false;
+    }
+
+    Rect_t bounds;
+    text_run_bounds(run, x, y, &bounds);
+    if (bounds.width <= 0 || bounds.height <= 0)
+    {
+        return true;
+    }
+
+    // clip to the screen, the driver would skip the rest anyway.
+    int32_t x1 = bounds.x < 0 ? 0 : bounds.x;
+    int32_t y1 = bounds.y < 0 ? 0 : bounds.y;
+    int32_t x2 = bounds.x + bounds.width;
+    int32_t y2 = bounds.y + bounds.height;
+    x2 = x2 > EPD_WIDTH ? EPD_WIDTH : x2;
+    y2 = y2 > EPD_HEIGHT ? EPD_HEIGHT : y2;
+    if (x1 >= x2 || y1 >= y2)
+    {
+        return true;
+    }
+
+    Rect_t *area = &batch->area;
+    if (batch->count > 0)
+    {
+        x1 = x1 < area->x ? x1 : area->x;
+        y1 = y1 < area->y ? y1 : area->y;
+        x2 = x2 > area->x + area->width ? x2 : area->x + area->width;
+        y2 = y2 > area->y + area->height ? y2 : area->y + area->height;
+    }
+    area->x = x1;
+    area->y = y1;
+    area->width = x2 - x1;
+    area->height = y2 - y1;
+
+    TextBatchItem *item = &batch->items[batch->count++];
+    item->run = run;
+    item->x = x;
+    item->y = y;
+    return true;
+}
+
+
+bool text_batch_add_layout(TextBatch *batch, const TextLayout *layout,
+                           int32_t x, int32_t y)
+{
+    return text_batch_add_run(batch, &layout->run, x, y);
+}
+
+
+void text_batch_draw(TextBatch *batch, uint8_t *framebuffer, DrawMode_t mode)
+{
+    if (batch->count == 0)
+    {
+        return;
+    }
+
+    if (framebuffer != NULL)
+    {
+        Rect_t screen = epd_full_screen();
+        for (uint32_t i = 0; i < batch->count; i++)
+        {
+            TextBatchItem *item = &batch->items[i];
+            text_run_render(item->run, item->x, item->y, framebuffer, &screen);
+        }
+        text_batch_init(batch, batch->items, batch->capacity);
+        return;
+    }
+
+    Rect_t area = batch->area;
+    uint32_t size = (area.width / 2 + area.width % 2) * area.height;
+    // pages do not fit into internal memory, scratch memory is in PSRAM.
+    uint8_t *buffer = (uint8_t *)arena_scratch_alloc(size);
+    if (buffer == NULL)
+    {
+        ESP_LOGE(TAG, "cannot allocate a %" PRId32 "x%" PRId32 " text buffer",
+                 area.width, area.height);
+        return;
+    }
+
+    memset(buffer, 255, size);
+    for (uint32_t i = 0; i < batch->count; i++)
+    {
+        TextBatchItem *item = &batch->items[i];
+        text_run_render(item->run, item->x, item->y, buffer, &area);
+    }
+    epd_draw_image(area, buffer, mode);
+    arena_scratch_free(buffer);
+
+    text_batch_init(batch, batch->items, batch->capacity);
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
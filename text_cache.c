@@ -0,0 +1,323 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "text_cache.h"
+#include "fnv.h"
+
+#include <esp_heap_caps.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+typedef struct
+{
+    text_cache_entry_t entry;
+    text_cache_key_t key;
+    bool used;
+    uint32_t size;
+    /// Value of `use_counter` at the last use.
+    uint32_t last_use;
+} cache_slot_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static bool key_equal(const text_cache_key_t *a, const text_cache_key_t *b);
+
+static void drop_slot(cache_slot_t *slot);
+
+/**
+ * @brief Drop the least recently used string.
+ *
+ * @return false if the cache is empty.
+ */
+static bool evict_one();
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static cache_slot_t slots[TEXT_CACHE_ENTRIES];
+static uint32_t use_counter = 0;
+static uint32_t limit = TEXT_CACHE_BYTES;
+
+static text_cache_stats_t stats;
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void text_cache_set_limit(uint32_t bytes)
+{
+    limit = bytes;
+    while (stats.bytes > limit && evict_one())
+    {
+    }
+}
+
+
+void text_cache_clear()
+{
+    for (int32_t i = 0; i < TEXT_CACHE_ENTRIES; i++)
+    {
+        if (slots[i].used)
+        {
+            drop_slot(&slots[i]);
+        }
+    }
+}
+
+
+void text_cache_get_stats(text_cache_stats_t *out)
+{
+    *out = stats;
+}
+
+
+void text_cache_reset_stats()
+{
+    stats.hits = 0;
+    stats.misses = 0;
+    stats.evictions = 0;
+}
+
+
+bool text_cache_key(text_cache_key_t *key, const GFXfont *font,
+                    const char *string, const FontProperties *props,
+                    int32_t x)
+{
+    if (limit == 0)
+    {
+        return false;
+    }
+
+    uint32_t length = 0;
+    while (string[length] != '\0')
+    {
+        if (++length > TEXT_CACHE_MAX_STRING)
+        {
+            return false;
+        }
+    }
+    if (length == 0)
+    {
+        return false;
+    }
+
+    memset(key, 0, sizeof(text_cache_key_t));
+    key->font = font;
+    key->hash = fnv1a_64(FNV1A_64_INIT, string, length);
+    key->length = length;
+    key->props.fg_color = props->fg_color;
+    key->props.bg_color = props->bg_color;
+    key->props.fallback_glyph = props->fallback_glyph;
+    key->props.flags = props->flags;
+    key->x_parity = x & 1;
+    return true;
+}
+
+
+const text_cache_entry_t *text_cache_lookup(const text_cache_key_t *key)
+{
+    for (int32_t i = 0; i < TEXT_CACHE_ENTRIES; i++)
+    {
+        cache_slot_t *slot = &slots[i];
+        if (slot->used && key_equal(&slot->key, key))
+        {
+            slot->last_use = ++use_counter;
+            stats.hits++;
+            return &slot->entry;
+        }
+    }
+    stats.misses++;
+    return NULL;
+}
+
+
+text_cache_entry_t *text_cache_insert(const text_cache_key_t *key, Rect_t area)
+{
+    uint32_t image_size = (area.width / 2 + area.width % 2) * area.height;
+    uint32_t mask_size = (area.width + 7) / 8 * area.height;
+    uint32_t size = image_size + mask_size;
+    if (size == 0 || size > limit)
+    {
+        return NULL;
+    }
+
+    cache_slot_t *slot = NULL;
+    while (slot == NULL)
+    {
+        for (int32_t i = 0; i < TEXT_CACHE_ENTRIES && slot == NULL; i++)
+        {
+            if (!slots[i].used)
+            {
+                slot = &slots[i];
+            }
+        }
+        if (slot == NULL && !evict_one())
+        {
+            return NULL;
+        }
+    }
+    while (stats.bytes + size > limit && evict_one())
+    {
+    }
+
+    // image and mask share one block in external memory.
+    uint8_t *block = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (block == NULL)
+    {
+        block = (uint8_t *)malloc(size);
+    }
+    if (block == NULL)
+    {
+        return NULL;
+    }
+    memset(block, 255, image_size);
+    memset(block + image_size, 0, mask_size);
+
+    slot->used = true;
+    slot->key = *key;
+    slot->size = size;
+    slot->last_use = ++use_counter;
+    slot->entry.area = area;
+    slot->entry.pen_x = 0;
+    slot->entry.pen_y = 0;
+    slot->entry.image = block;
+    slot->entry.mask = block + image_size;
+    stats.bytes += size;
+    stats.entries++;
+    return &slot->entry;
+}
+
+
+void text_cache_mark(text_cache_entry_t *entry, int32_t x, int32_t y,
+                     int32_t width, int32_t height)
+{
+    int32_t x0 = x < 0 ? 0 : x;
+    int32_t y0 = y < 0 ? 0 : y;
+    int32_t x1 = x + width > entry->area.width ? entry->area.width : x + width;
+    int32_t y1 = y + height > entry->area.height ? entry->area.height : y + height;
+    int32_t stride = (entry->area.width + 7) / 8;
+
+    for (int32_t yy = y0; yy < y1; yy++)
+    {
+        uint8_t *row = &entry->mask[yy * stride];
+        for (int32_t xx = x0; xx < x1; xx++)
+        {
+            row[xx / 8] |= 1 << (xx % 8);
+        }
+    }
+}
+
+
+void text_cache_blit(const text_cache_entry_t *entry, int32_t x, int32_t y,
+                     uint8_t *framebuffer)
+{
+    const Rect_t *area = &entry->area;
+    int32_t sx = x + area->x;
+    int32_t sy = y + area->y;
+    int32_t image_stride = area->width / 2 + area->width % 2;
+    int32_t mask_stride = (area->width + 7) / 8;
+
+    // clip once, the image starts on a byte boundary.
+    int32_t c0 = sx < 0 ? -sx : 0;
+    int32_t c1 = sx + area->width > EPD_WIDTH ? EPD_WIDTH - sx : area->width;
+    int32_t r0 = sy < 0 ? -sy : 0;
+    int32_t r1 = sy + area->height > EPD_HEIGHT ? EPD_HEIGHT - sy : area->height;
+
+    for (int32_t r = r0; r < r1; r++)
+    {
+        const uint8_t *src = &entry->image[r * image_stride];
+        const uint8_t *mask = &entry->mask[r * mask_stride];
+        uint8_t *dst = &framebuffer[(sy + r) * EPD_WIDTH / 2 + sx / 2];
+        for (int32_t c = c0; c < c1; c += 2)
+        {
+            uint8_t m = (mask[c / 8] >> (c % 8)) & 0b11;
+            if (c + 1 >= c1)
+            {
+                m &= 0b01;
+            }
+            switch (m)
+            {
+            case 0b11:
+                dst[c / 2] = src[c / 2];
+                break;
+            case 0b01:
+                dst[c / 2] = (dst[c / 2] & 0xF0) | (src[c / 2] & 0x0F);
+                break;
+            case 0b10:
+                dst[c / 2] = (dst[c / 2] & 0x0F) | (src[c / 2] & 0xF0);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static bool key_equal(const text_cache_key_t *a, const text_cache_key_t *b)
+{
+    return a->font == b->font && a->hash == b->hash &&
+           a->length == b->length && a->x_parity == b->x_parity &&
+           a->props.fg_color == b->props.fg_color &&
+           a->props.bg_color == b->props.bg_color &&
+           a->props.fallback_glyph == b->props.fallback_glyph &&
+           a->props.flags == b->props.flags;
+}
+
+
+static void drop_slot(cache_slot_t *slot)
+{
+    free(slot->entry.image);
+    slot->entry.image = NULL;
+    slot->entry.mask = NULL;
+    slot->used = false;
+    stats.bytes -= slot->size;
+    stats.entries--;
+}
+
+
+static bool evict_one()
+{
+    cache_slot_t *oldest = NULL;
+    for (int32_t i = 0; i < TEXT_CACHE_ENTRIES; i++)
+    {
+        cache_slot_t *slot = &slots[i];
+        if (slot->used &&
+            (oldest == NULL || use_counter - slot->last_use >
+                                   use_counter - oldest->last_use))
+        {
+            oldest = slot;
+        }
+    }
+    if (oldest == NULL)
+    {
+        return false;
+    }
+    drop_slot(oldest);
+    stats.evictions++;
+    return true;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,276 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "text_layout.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/**
+ * @brief Returns true if a line may break after the character.
+ */
+static inline bool is_break_after(char c);
+
+/**
+ * @brief Number of bytes of the UTF-8 sequence starting with `lead`.
+ */
+static inline uint32_t sequence_length(uint8_t lead);
+
+/**
+ * @brief Store the line of glyphs [first, end).
+ *
+ * @return false if the line storage is full.
+ */
+static bool finish_line(TextLayout *layout, const char *text, uint32_t first,
+                        uint32_t end, int32_t y);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void text_layout_init(TextLayout *layout, const GFXfont *font,
+                      GlyphPosition *glyphs, uint32_t glyph_capacity,
+                      LineBox *lines, uint32_t line_capacity, int32_t width,
+                      const FontProperties *props)
+{
+    text_run_init(&layout->run, font, glyphs, glyph_capacity, props);
+    layout->lines = lines;
+    layout->line_capacity = line_capacity;
+    layout->line_count = 0;
+    layout->width = width;
+    layout->height = 0;
+}
+
+
+const char *text_layout_set_text(TextLayout *layout, const char *text)
+{
+    TextRun *run = &layout->run;
+    const GFXfont *font = run->font;
+    GlyphPosition *glyphs = run->glyphs;
+
+    text_run_init(run, font, glyphs, run->capacity, &run->props);
+    layout->line_count = 0;
+    layout->height = 0;
+
+    const char *rest = text_run_shape(run, text);
+    uint32_t rest_offset = rest - text;
+
+    // glyphs are moved to their line in place, `out` never passes `i`.
+    uint32_t out = 0;
+    uint32_t line_first = 0;
+    // first glyph after the last break opportunity of the line.
+    uint32_t brk = 0;
+    // shaped x position of the line start.
+    int32_t line_x0 = 0;
+    // shaped base line of the current hard line.
+    int32_t shaped_y = 0;
+    int32_t y = 0;
+    bool wrapped = false;
+    bool full = false;
+
+    for (uint32_t i = 0; i < run->count; i++)
+    {
+        GlyphPosition g = glyphs[i];
+        char c = text[g.offset];
+        bool space = c == ' ';
+
+        // a line feed in the text.
+        if (g.y != shaped_y)
+        {
+            if (!finish_line(layout, text, line_first, out, y))
+            {
+                full = true;
+                rest_offset = line_first < out ? glyphs[line_first].offset : g.offset;
+                break;
+            }
+            y += g.y - shaped_y;
+            shaped_y = g.y;
+            line_first = out;
+            brk = out;
+            line_x0 = g.x;
+            wrapped = false;
+        }
+
+        // wrapped lines do not start with a space.
+        if (space && wrapped && out == line_first)
+        {
+            continue;
+        }
+
+        int32_t x = g.x - line_x0;
+        if (x + g.glyph->advance_x > layout->width && out > line_first)
+        {
+            // spaces may hang over the line end.
+            if (space)
+            {
+                brk = out;
+                continue;
+            }
+
+            // break at the last opportunity, or split an overlong word.
+            uint32_t split = brk > line_first ? brk : out;
+            if (!finish_line(layout, text, line_first, split, y))
+            {
+                full = true;
+                rest_offset = glyphs[line_first].offset;
+                break;
+            }
+            y += font->advance_y;
+            int32_t dx = split < out ? glyphs[split].x : x;
+            for (uint32_t k = split; k < out; k++)
+            {
+                glyphs[k].x -= dx;
+                glyphs[k].y = y;
+            }
+            line_first = split;
+            brk = split;
+            line_x0 += dx;
+            x -= dx;
+            wrapped = true;
+        }
+
+        glyphs[out] = g;
+        glyphs[out].x = x;
+        glyphs[out].y = y;
+        out++;
+        if (space || is_break_after(c))
+        {
+            brk = out;
+        }
+    }
+
+    if (!full)
+    {
+        bool complete = *rest == '\0';
+        if (!complete && layout->line_count > 0)
+        {
+            // the last line may continue in the text which did not fit.
+            rest_offset = line_first < out ? glyphs[line_first].offset : rest_offset;
+        }
+        else if (!finish_line(layout, text, line_first, out, y))
+        {
+            rest_offset = glyphs[line_first].offset;
+        }
+    }
+
+    if (layout->line_count > 0)
+    {
+        LineBox *last = &layout->lines[layout->line_count - 1];
+        run->count = last->first + last->count;
+        layout->height = last->y + font->advance_y;
+    }
+    else
+    {
+        run->count = 0;
+    }
+    text_run_update_bounds(run);
+    return text + rest_offset;
+}
+
+
+void text_layout_draw(const TextLayout *layout, int32_t x, int32_t y,
+                      uint8_t *framebuffer, DrawMode_t mode)
+{
+    text_run_draw(&layout->run, x, y, framebuffer, mode);
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static inline bool is_break_after(char c)
+{
+    switch (c)
+    {
+    case '-':
+    case '/':
+    case ',':
+    case '.':
+    case ';':
+    case ':':
+    case '!':
+    case '?':
+    case ')':
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+static inline uint32_t sequence_length(uint8_t lead)
+{
+    if (lead < 0x80)
+    {
+        return 1;
+    }
+    if ((lead & 0xE0) == 0xC0)
+    {
+        return 2;
+    }
+    if ((lead & 0xF0) == 0xE0)
+    {
+        return 3;
+    }
+    return 4;
+}
+
+
+static bool finish_line(TextLayout *layout, const char *text, uint32_t first,
+                        uint32_t end, int32_t y)
+{
+    if (end == first)
+    {
+        return true;
+    }
+    if (layout->line_count == layout->line_capacity)
+    {
+        return false;
+    }
+
+    const GlyphPosition *glyphs = layout->run.glyphs;
+    LineBox *line = &layout->lines[layout->line_count++];
+    line->first = first;
+    line->count = end - first;
+    line->start = glyphs[first].offset;
+    uint32_t last = glyphs[end - 1].offset;
+    line->end = last + sequence_length(text[last]);
+    line->y = y;
+
+    // trailing spaces do not count.
+    line->width = 0;
+    for (uint32_t i = end; i > first; i--)
+    {
+        if (text[glyphs[i - 1].offset] != ' ')
+        {
+            line->width = glyphs[i - 1].x + glyphs[i - 1].glyph->advance_x;
+            break;
+        }
+    }
+    return true;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,827 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "text_table.h"
+#include "arena.h"
+#include "fnv.h"
+#include "text_layout.h"
+
+#include <esp_log.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/// Lines are never wrapped when measuring the natural width of a cell.
+#define UNLIMITED_WIDTH (INT32_MAX / 2)
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Storage for laying out one cell at a time.
+ */
+typedef struct
+{
+    TextLayout layout;
+    GlyphPosition glyphs[TEXT_TABLE_CELL_GLYPHS];
+    LineBox lines[TEXT_TABLE_CELL_LINES];
+} cell_scratch_t;
+
+/**
+ * @brief Position and size of the parts of a table.
+ */
+typedef struct
+{
+    int32_t widths[TEXT_TABLE_MAX_COLUMNS]; /** Column widths, without grid */
+    int32_t *heights;       /** Row heights, without grid */
+    int32_t caption_height; /** Caption height, its padding included */
+    int32_t width;          /** Table width, grid included */
+    int32_t height;         /** Table height, caption included */
+} table_geometry_t;
+
+/**
+ * @brief Header of a packed table, followed by its cells and text.
+ */
+typedef struct
+{
+    uint32_t cell_count;
+    uint32_t text_length;
+    int32_t caption;
+    uint16_t row_count;
+    uint16_t column_count;
+} packed_table_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+static bool store_text(TextTable *table, const char *text, uint32_t length,
+                       uint32_t *offset);
+
+/**
+ * @brief Lay out a text to a width.
+ *
+ * @return The widest line in pixels.
+ */
+static int32_t layout_text(cell_scratch_t *scratch, const GFXfont *font,
+                           const char *text, int32_t width);
+
+/**
+ * @brief Share the available width between the columns.
+ *
+ * Columns narrower than an equal share keep their natural width, the others
+ * split the rest evenly.
+ */
+static void fit_columns(int32_t *widths, uint32_t count, int32_t available);
+
+/**
+ * @brief Measure the columns, rows and caption of a table.
+ *
+ * @return false if the row heights cannot be allocated. Otherwise the caller
+ *         frees `geometry->heights`.
+ */
+static bool measure_table(const TextTable *table, const GFXfont *font,
+                          int32_t width, cell_scratch_t *scratch,
+                          table_geometry_t *geometry);
+
+/**
+ * @brief Render the parts of a table that overlap a buffer.
+ */
+static void render_table(const TextTable *table, const GFXfont *font,
+                         const table_geometry_t *geometry, int32_t x, int32_t y,
+                         uint8_t line_color, cell_scratch_t *scratch,
+                         uint8_t *buffer, const Rect_t *buffer_area);
+
+/**
+ * @brief Render an area of a table and draw it to the display.
+ */
+static void draw_area(const TextTable *table, const GFXfont *font,
+                      const table_geometry_t *geometry, int32_t x, int32_t y,
+                      uint8_t line_color, cell_scratch_t *scratch, Rect_t area,
+                      DrawMode_t mode);
+
+static uint64_t layout_hash(const GFXfont *font, const Rect_t *area,
+                            uint8_t line_color,
+                            const table_geometry_t *geometry, uint32_t rows);
+
+static uint32_t fold_hash(uint64_t hash);
+
+static Rect_t union_rect(const Rect_t *a, const Rect_t *b);
+
+/**
+ * @brief Fill a rectangle of a 4 bit buffer, in screen coordinates.
+ */
+static void fill_rect(uint8_t *buffer, const Rect_t *buffer_area, int32_t x,
+                      int32_t y, int32_t w, int32_t h, uint8_t color);
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+static const char *TAG = "text_table";
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+void text_table_init(TextTable *table, TableCell *cells, uint32_t cell_capacity,
+                     char *text, uint32_t text_capacity)
+{
+    table->cells = cells;
+    table->cell_capacity = cell_capacity;
+    table->cell_count = 0;
+    table->text = text;
+    table->text_capacity = text_capacity;
+    table->text_length = 0;
+    table->caption = -1;
+    table->row_count = 0;
+    table->column_count = 0;
+    table->column = 0;
+}
+
+
+bool text_table_set_caption(TextTable *table, const char *text,
+                            uint32_t length)
+{
+    uint32_t offset;
+    if (!store_text(table, text, length, &offset))
+    {
+        return false;
+    }
+    table->caption = offset;
+    return true;
+}
+
+
+bool text_table_add_cell(TextTable *table, const char *text, uint32_t length)
+{
+    if (table->cell_count == table->cell_capacity ||
+        table->column == TEXT_TABLE_MAX_COLUMNS)
+    {
+        return false;
+    }
+
+    uint32_t offset;
+    if (!store_text(table, text, length, &offset))
+    {
+        return false;
+    }
+
+    if (table->column == 0)
+    {
+        table->row_count++;
+    }
+    TableCell *cell = &table->cells[table->cell_count++];
+    cell->row = table->row_count - 1;
+    cell->column = table->column++;
+    cell->offset = offset;
+    if (table->column > table->column_count)
+    {
+        table->column_count = table->column;
+    }
+    return true;
+}
+
+
+void text_table_end_row(TextTable *table)
+{
+    table->column = 0;
+}
+
+
+const char *text_table_cell(const TextTable *table, uint32_t row,
+                            uint32_t column)
+{
+    for (uint32_t i = 0; i < table->cell_count; i++)
+    {
+        const TableCell *cell = &table->cells[i];
+        if (cell->row == row && cell->column == column)
+        {
+            return &table->text[cell->offset];
+        }
+    }
+    return NULL;
+}
+
+
+uint32_t text_table_pack(const TextTable *table, void *data, uint32_t capacity)
+{
+    uint32_t cells_size = table->cell_count * sizeof(TableCell);
+    uint32_t size = sizeof(packed_table_t) + cells_size + table->text_length;
+    if (size > capacity)
+    {
+        return size;
+    }
+
+    packed_table_t header = {
+        .cell_count = table->cell_count,
+        .text_length = table->text_length,
+        .caption = table->caption,
+        .row_count = table->row_count,
+        .column_count = table->column_count,
+    };
+    uint8_t *out = (uint8_t *)data;
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), table->cells, cells_size);
+    memcpy(out + sizeof(header) + cells_size, table->text, table->text_length);
+    return size;
+}
+
+
+bool text_table_unpack(TextTable *table, const void *data, uint32_t length)
+{
+    packed_table_t header;
+    if (length < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.cell_count > table->cell_capacity ||
+        header.text_length > table->text_capacity ||
+        length != sizeof(header) + header.cell_count * sizeof(TableCell) +
+                      header.text_length ||
+        header.column_count > TEXT_TABLE_MAX_COLUMNS)
+    {
+        return false;
+    }
+
+    const uint8_t *in = (const uint8_t *)data + sizeof(header);
+    memcpy(table->cells, in, header.cell_count * sizeof(TableCell));
+    memcpy(table->text, in + header.cell_count * sizeof(TableCell),
+           header.text_length);
+
+    // the text is used as strings, every offset must point into it.
+    bool valid = header.text_length == 0 ||
+                 table->text[header.text_length - 1] == '\0';
+    valid = valid && (header.caption < 0 ||
+                      (uint32_t)header.caption < header.text_length);
+    for (uint32_t i = 0; valid && i < header.cell_count; i++)
+    {
+        const TableCell *cell = &table->cells[i];
+        valid = cell->offset < header.text_length &&
+                cell->row < header.row_count &&
+                cell->column < header.column_count &&
+                (i == 0 || cell->row >= table->cells[i - 1].row);
+    }
+    if (!valid)
+    {
+        text_table_init(table, table->cells, table->cell_capacity, table->text,
+                        table->text_capacity);
+        return false;
+    }
+
+    table->cell_count = header.cell_count;
+    table->text_length = header.text_length;
+    table->caption = header.caption;
+    table->row_count = header.row_count;
+    table->column_count = header.column_count;
+    table->column = 0;
+    return true;
+}
+
+
+void text_table_fingerprint(const TextTable *table, TableFingerprint *fingerprint)
+{
+    memset(fingerprint, 0, sizeof(TableFingerprint));
+    fingerprint->row_count = table->row_count;
+
+    uint64_t caption = FNV1A_64_INIT;
+    if (table->caption >= 0)
+    {
+        caption = fnv1a_64_string(caption, &table->text[table->caption]);
+    }
+    fingerprint->caption = fold_hash(caption);
+
+    // rows past the tracked ones share the last hash.
+    uint64_t row_hash = FNV1A_64_INIT;
+    uint32_t slot = 0;
+    for (uint32_t i = 0; i < table->cell_count; i++)
+    {
+        const TableCell *cell = &table->cells[i];
+        uint32_t cell_slot = cell->row < TEXT_TABLE_TRACKED_ROWS
+                                 ? cell->row
+                                 : TEXT_TABLE_TRACKED_ROWS - 1;
+        if (cell_slot != slot)
+        {
+            fingerprint->rows[slot] = fold_hash(row_hash);
+            row_hash = FNV1A_64_INIT;
+            slot = cell_slot;
+        }
+        uint16_t position[2] = {cell->row, cell->column};
+        row_hash = fnv1a_64(row_hash, position, sizeof(position));
+        row_hash = fnv1a_64(row_hash, &table->text[cell->offset],
+                            strlen(&table->text[cell->offset]) + 1);
+    }
+    if (table->cell_count > 0)
+    {
+        fingerprint->rows[slot] = fold_hash(row_hash);
+    }
+
+    uint64_t content = fnv1a_64(caption, &table->row_count,
+                                sizeof(table->row_count));
+    content = fnv1a_64(content, &table->column_count,
+                       sizeof(table->column_count));
+    content = fnv1a_64(content, fingerprint->rows, sizeof(fingerprint->rows));
+    // 0 is reserved for "nothing shown".
+    fingerprint->content = content != 0 ? content : 1;
+}
+
+
+int32_t text_table_draw(const TextTable *table, const GFXfont *font,
+                        int32_t x, int32_t y, int32_t width,
+                        uint8_t line_color, uint8_t *framebuffer,
+                        DrawMode_t mode)
+{
+    if (table->column_count == 0 && table->caption < 0)
+    {
+        return 0;
+    }
+
+    cell_scratch_t *scratch =
+        (cell_scratch_t *)arena_scratch_alloc(sizeof(cell_scratch_t));
+    table_geometry_t geometry;
+    if (scratch == NULL || !measure_table(table, font, width, scratch, &geometry))
+    {
+        ESP_LOGE(TAG, "cannot allocate table layout");
+        arena_scratch_free(scratch);
+        return 0;
+    }
+
+    if (framebuffer != NULL)
+    {
+        Rect_t screen = epd_full_screen();
+        render_table(table, font, &geometry, x, y, line_color, scratch,
+                     framebuffer, &screen);
+    }
+    else
+    {
+        Rect_t area = {
+            .x = x,
+            .y = y,
+            .width = geometry.width,
+            .height = geometry.height,
+        };
+        draw_area(table, font, &geometry, x, y, line_color, scratch, area, mode);
+    }
+
+    int32_t height = geometry.height;
+    arena_scratch_free(geometry.heights);
+    arena_scratch_free(scratch);
+    return height;
+}
+
+
+TableUpdate text_table_update(const TextTable *table, const GFXfont *font,
+                              int32_t x, int32_t y, int32_t width,
+                              uint8_t line_color, DrawMode_t mode,
+                              TableFingerprint *shown)
+{
+    TableFingerprint current;
+    text_table_fingerprint(table, &current);
+    if (table->column_count == 0 && table->caption < 0)
+    {
+        // an empty table is drawn as nothing.
+        if (shown->content != 0)
+        {
+            epd_clear_area(shown->area);
+        }
+        *shown = current;
+        return TEXT_TABLE_REDRAWN;
+    }
+
+    cell_scratch_t *scratch =
+        (cell_scratch_t *)arena_scratch_alloc(sizeof(cell_scratch_t));
+    table_geometry_t geometry;
+    if (scratch == NULL || !measure_table(table, font, width, scratch, &geometry))
+    {
+        ESP_LOGE(TAG, "cannot allocate table layout");
+        arena_scratch_free(scratch);
+        return TEXT_TABLE_UNCHANGED;
+    }
+
+    // the panel keeps what is drawn, only what moved or changed is updated.
+    current.area = (Rect_t){
+        .x = x,
+        .y = y,
+        .width = geometry.width,
+        .height = geometry.height,
+    };
+    current.layout = layout_hash(font, &current.area, line_color, &geometry,
+                                 table->row_count);
+
+    TableUpdate update;
+    if (shown->content == current.content && shown->layout == current.layout)
+    {
+        update = TEXT_TABLE_UNCHANGED;
+    }
+    else if (shown->content != 0 && shown->layout == current.layout)
+    {
+        update = TEXT_TABLE_PARTIAL;
+        if (shown->caption != current.caption)
+        {
+            Rect_t area = {
+                .x = x,
+                .y = y,
+                .width = geometry.width,
+                .height = geometry.caption_height,
+            };
+            epd_clear_area(area);
+            draw_area(table, font, &geometry, x, y, line_color, scratch, area,
+                      mode);
+        }
+
+        // adjacent changed rows are updated as one stripe.
+        int32_t row_y = y + geometry.caption_height + 1;
+        int32_t first_y = -1;
+        for (uint32_t r = 0; r <= table->row_count; r++)
+        {
+            uint32_t slot = r < TEXT_TABLE_TRACKED_ROWS
+                                ? r
+                                : TEXT_TABLE_TRACKED_ROWS - 1;
+            bool changed = r < table->row_count &&
+                           shown->rows[slot] != current.rows[slot];
+            if (changed && first_y < 0)
+            {
+                first_y = row_y;
+            }
+            if (!changed && first_y >= 0)
+            {
+                Rect_t area = {
+                    .x = x,
+                    .y = first_y,
+                    .width = geometry.width,
+                    .height = row_y - 1 - first_y,
+                };
+                epd_clear_area(area);
+                draw_area(table, font, &geometry, x, y, line_color, scratch,
+                          area, mode);
+                first_y = -1;
+            }
+            if (r < table->row_count)
+            {
+                row_y += geometry.heights[r] + 1;
+            }
+        }
+    }
+    else
+    {
+        update = TEXT_TABLE_REDRAWN;
+        if (shown->content != 0)
+        {
+            epd_clear_area(union_rect(&shown->area, &current.area));
+        }
+        draw_area(table, font, &geometry, x, y, line_color, scratch,
+                  current.area, mode);
+    }
+
+    *shown = current;
+    arena_scratch_free(geometry.heights);
+    arena_scratch_free(scratch);
+    return update;
+}
+
+/******************************************************************************/
+/***        local functions                                                 ***/
+/******************************************************************************/
+
+static bool store_text(TextTable *table, const char *text, uint32_t length,
+                       uint32_t *offset)
+{
+    if (length >= table->text_capacity - table->text_length)
+    {
+        return false;
+    }
+    *offset = table->text_length;
+    memcpy(&table->text[table->text_length], text, length);
+    table->text_length += length;
+    table->text[table->text_length++] = '\0';
+    return true;
+}
+
+
+static int32_t layout_text(cell_scratch_t *scratch, const GFXfont *font,
+                           const char *text, int32_t width)
+{
+    TextLayout *layout = &scratch->layout;
+    text_layout_init(layout, font, scratch->glyphs, TEXT_TABLE_CELL_GLYPHS,
+                     scratch->lines, TEXT_TABLE_CELL_LINES, width, NULL);
+    text_layout_set_text(layout, text);
+
+    int32_t widest = 0;
+    for (uint32_t i = 0; i < layout->line_count; i++)
+    {
+        if (layout->lines[i].width > widest)
+        {
+            widest = layout->lines[i].width;
+        }
+    }
+    return widest;
+}
+
+
+static void fit_columns(int32_t *widths, uint32_t count, int32_t available)
+{
+    int32_t total = 0;
+    for (uint32_t c = 0; c < count; c++)
+    {
+        total += widths[c];
+    }
+    if (total <= available)
+    {
+        return;
+    }
+
+    // water-filling: fix narrow columns until the rest share evenly.
+    bool fixed[TEXT_TABLE_MAX_COLUMNS] = {false};
+    uint32_t left = count;
+    bool changed = true;
+    while (changed && left > 0)
+    {
+        changed = false;
+        int32_t share = available / (int32_t)left;
+        for (uint32_t c = 0; c < count; c++)
+        {
+            if (!fixed[c] && widths[c] <= share)
+            {
+                fixed[c] = true;
+                available -= widths[c];
+                left--;
+                changed = true;
+            }
+        }
+    }
+    for (uint32_t c = 0, i = 0; c < count; c++)
+    {
+        if (!fixed[c])
+        {
+            // hand out the remainder pixels from the left.
+            widths[c] = available / (int32_t)left +
+                        ((int32_t)i++ < available % (int32_t)left ? 1 : 0);
+        }
+        // a column always has room for its padding and some text.
+        if (widths[c] < 3 * TEXT_TABLE_PADDING)
+        {
+            widths[c] = 3 * TEXT_TABLE_PADDING;
+        }
+    }
+}
+
+
+static bool measure_table(const TextTable *table, const GFXfont *font,
+                          int32_t width, cell_scratch_t *scratch,
+                          table_geometry_t *geometry)
+{
+    uint32_t columns = table->column_count;
+    uint32_t rows = table->row_count;
+    geometry->heights =
+        (int32_t *)arena_scratch_alloc((rows + 1) * sizeof(int32_t));
+    if (geometry->heights == NULL)
+    {
+        return false;
+    }
+    int32_t *widths = geometry->widths;
+    int32_t *heights = geometry->heights;
+
+    // natural column widths, each cell on as few lines as possible.
+    memset(widths, 0, sizeof(geometry->widths));
+    for (uint32_t i = 0; i < table->cell_count; i++)
+    {
+        const TableCell *cell = &table->cells[i];
+        int32_t natural = layout_text(scratch, font, &table->text[cell->offset],
+                                      UNLIMITED_WIDTH);
+        if (natural + 2 * TEXT_TABLE_PADDING > widths[cell->column])
+        {
+            widths[cell->column] = natural + 2 * TEXT_TABLE_PADDING;
+        }
+    }
+    // one pixel grid lines left of each column and right of the last.
+    fit_columns(widths, columns, width - (int32_t)columns - 1);
+    int32_t table_width = columns + 1;
+    for (uint32_t c = 0; c < columns; c++)
+    {
+        table_width += widths[c];
+    }
+
+    // row heights from the wrapped cells.
+    int32_t caption_height = 0;
+    if (table->caption >= 0)
+    {
+        layout_text(scratch, font, &table->text[table->caption],
+                    columns > 0 ? table_width : width);
+        caption_height = scratch->layout.line_count * font->advance_y +
+                         TEXT_TABLE_PADDING;
+        table_width = columns > 0 ? table_width : width;
+    }
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        heights[r] = font->advance_y + 2 * TEXT_TABLE_PADDING;
+    }
+    for (uint32_t i = 0; i < table->cell_count; i++)
+    {
+        const TableCell *cell = &table->cells[i];
+        layout_text(scratch, font, &table->text[cell->offset],
+                    widths[cell->column] - 2 * TEXT_TABLE_PADDING);
+        int32_t height = scratch->layout.line_count * font->advance_y +
+                         2 * TEXT_TABLE_PADDING;
+        if (height > heights[cell->row])
+        {
+            heights[cell->row] = height;
+        }
+    }
+    int32_t table_height = caption_height + (rows > 0 ? 1 : 0);
+    for (uint32_t r = 0; r < rows; r++)
+    {
+        table_height += heights[r] + 1;
+    }
+
+    geometry->caption_height = caption_height;
+    geometry->width = table_width;
+    geometry->height = table_height;
+    return true;
+}
+
+
+static void render_table(const TextTable *table, const GFXfont *font,
+                         const table_geometry_t *geometry, int32_t x, int32_t y,
+                         uint8_t line_color, cell_scratch_t *scratch,
+                         uint8_t *buffer, const Rect_t *buffer_area)
+{
+    uint32_t columns = table->column_count;
+    uint32_t rows = table->row_count;
+    const int32_t *widths = geometry->widths;
+    const int32_t *heights = geometry->heights;
+    int32_t buffer_bottom = buffer_area->y + buffer_area->height;
+
+    if (table->caption >= 0 && y + geometry->caption_height > buffer_area->y)
+    {
+        layout_text(scratch, font, &table->text[table->caption],
+                    geometry->width);
+        text_run_render(&scratch->layout.run, x, y + font->ascender, buffer,
+                        buffer_area);
+    }
+
+    // the grid, rows and columns are separated by one pixel lines.
+    int32_t grid_y = y + geometry->caption_height;
+    int32_t grid_height = geometry->height - geometry->caption_height;
+    if (rows > 0)
+    {
+        int32_t line_y = grid_y;
+        for (uint32_t r = 0; r <= rows; r++)
+        {
+            fill_rect(buffer, buffer_area, x, line_y, geometry->width, 1,
+                      line_color);
+            line_y += r < rows ? heights[r] + 1 : 0;
+        }
+        int32_t line_x = x;
+        for (uint32_t c = 0; c <= columns; c++)
+        {
+            fill_rect(buffer, buffer_area, line_x, grid_y, 1, grid_height,
+                      line_color);
+            line_x += c < columns ? widths[c] + 1 : 0;
+        }
+    }
+
+    // cells are stored row by row, so their position is accumulated.
+    int32_t row_y = grid_y + 1;
+    uint32_t row = 0;
+    for (uint32_t i = 0; i < table->cell_count; i++)
+    {
+        const TableCell *cell = &table->cells[i];
+        for (; row < cell->row; row++)
+        {
+            row_y += heights[row] + 1;
+        }
+        if (row_y >= buffer_bottom)
+        {
+            break;
+        }
+        if (row_y + heights[row] <= buffer_area->y)
+        {
+            // rows outside the buffer are not laid out.
+            continue;
+        }
+        int32_t cell_x = x + 1;
+        for (uint32_t c = 0; c < cell->column; c++)
+        {
+            cell_x += widths[c] + 1;
+        }
+        layout_text(scratch, font, &table->text[cell->offset],
+                    widths[cell->column] - 2 * TEXT_TABLE_PADDING);
+        text_run_render(&scratch->layout.run, cell_x + TEXT_TABLE_PADDING,
+                        row_y + TEXT_TABLE_PADDING + font->ascender, buffer,
+                        buffer_area);
+    }
+}
+
+
+static void draw_area(const TextTable *table, const GFXfont *font,
+                      const table_geometry_t *geometry, int32_t x, int32_t y,
+                      uint8_t line_color, cell_scratch_t *scratch, Rect_t area,
+                      DrawMode_t mode)
+{
+    uint32_t size = (area.width / 2 + area.width % 2) * area.height;
+    // tables do not fit into internal memory, scratch memory is in PSRAM.
+    uint8_t *buffer = (uint8_t *)arena_scratch_alloc(size);
+    if (buffer == NULL)
+    {
+        ESP_LOGE(TAG, "cannot allocate a %" PRId32 "x%" PRId32 " table buffer",
+                 area.width, area.height);
+        return;
+    }
+    memset(buffer, 255, size);
+
+    render_table(table, font, geometry, x, y, line_color, scratch, buffer,
+                 &area);
+    epd_draw_image(area, buffer, mode);
+    arena_scratch_free(buffer);
+}
+
+
+static uint64_t layout_hash(const GFXfont *font, const Rect_t *area,
+                            uint8_t line_color,
+                            const table_geometry_t *geometry, uint32_t rows)
+{
+    uint64_t hash = fnv1a_64(FNV1A_64_INIT, &font, sizeof(font));
+    hash = fnv1a_64(hash, area, sizeof(Rect_t));
+    hash = fnv1a_64(hash, &line_color, sizeof(line_color));
+    hash = fnv1a_64(hash, &geometry->caption_height,
+                    sizeof(geometry->caption_height));
+    hash = fnv1a_64(hash, geometry->widths, sizeof(geometry->widths));
+    return fnv1a_64(hash, geometry->heights, rows * sizeof(int32_t));
+}
+
+
+static uint32_t fold_hash(uint64_t hash)
+{
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+
+static Rect_t union_rect(const Rect_t *a, const Rect_t *b)
+{
+    int32_t x0 = a->x < b->x ? a->x : b->x;
+    int32_t y0 = a->y < b->y ? a->y : b->y;
+    int32_t x1 = a->x + a->width > b->x + b->width ? a->x + a->width
+                                                   : b->x + b->width;
+    int32_t y1 = a->y + a->height > b->y + b->height ? a->y + a->height
+                                                     : b->y + b->height;
+    Rect_t area = {
+        .x = x0,
+        .y = y0,
+        .width = x1 - x0,
+        .height = y1 - y0,
+    };
+    return area;
+}
+
+
+static void fill_rect(uint8_t *buffer, const Rect_t *buffer_area, int32_t x,
+                      int32_t y, int32_t w, int32_t h, uint8_t color)
+{
+    int32_t stride = buffer_area->width / 2 + buffer_area->width % 2;
+    int32_t x0 = x - buffer_area->x;
+    int32_t y0 = y - buffer_area->y;
+    int32_t x1 = x0 + w;
+    int32_t y1 = y0 + h;
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > buffer_area->width ? buffer_area->width : x1;
+    y1 = y1 > buffer_area->height ? buffer_area->height : y1;
+
+    uint8_t nibble = color >> 4;
+    for (int32_t yy = y0; yy < y1; yy++)
+    {
+        uint8_t *row = &buffer[yy * stride];
+        int32_t xx = x0;
+        if (xx < x1 && (xx & 1))
+        {
+            row[xx / 2] = (row[xx / 2] & 0x0F) | (nibble << 4);
+            xx++;
+        }
+        // whole bytes of the span at once.
+        int32_t bytes = (x1 - xx) / 2;
+        if (bytes > 0)
+        {
+            memset(&row[xx / 2], nibble | (nibble << 4), bytes);
+            xx += 2 * bytes;
+        }
+        if (xx < x1)
+        {
+            row[xx / 2] = (row[xx / 2] & 0xF0) | nibble;
+        }
+    }
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/
@@ -0,0 +1,171 @@
+/******************************************************************************/
+/***        include files                                                   ***/
+/******************************************************************************/
+
+#include "utf8.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/******************************************************************************/
+/***        macro definitions                                               ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        type definitions                                                ***/
+/******************************************************************************/
+
+/**
+ * @brief Sequence length and valid second byte range of a lead byte.
+ */
+typedef struct
+{
+    uint8_t length; /** 0 if the byte cannot start a sequence */
+    uint8_t low;
+    uint8_t high;
+} utf8_lead_t;
+
+/******************************************************************************/
+/***        local function prototypes                                       ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        exported variables                                              ***/
+/******************************************************************************/
+
+/******************************************************************************/
+/***        local variables                                                 ***/
+/******************************************************************************/
+
+/**
+ * @brief Lead bytes 0xC0 to 0xFF, from table 3-7 of the Unicode standard.
+ *
+ * The second byte ranges reject overlong encodings (0xE0, 0xF0), surrogates
+ * (0xED) and code points above U+10FFFF (0xF4).
+ */
+static const utf8_lead_t leads[64] = {
+    [0x02 ... 0x1F] = {2, 0x80, 0xBF},
+    [0x20] = {3, 0xA0, 0xBF},
+    [0x21 ... 0x2C] = {3, 0x80, 0xBF},
+    [0x2D] = {3, 0x80, 0x9F},
+    [0x2E ... 0x2F] = {3, 0x80, 0xBF},
+    [0x30] = {4, 0x90, 0xBF},
+    [0x31 ... 0x33] = {4, 0x80, 0xBF},
+    [0x34] = {4, 0x80, 0x8F},
+};
+
+/******************************************************************************/
+/***        exported functions                                              ***/
+/******************************************************************************/
+
+uint32_t utf8_next(const char **string)
+{
+    const uint8_t *s = (const uint8_t *)*string;
+    uint8_t c = s[0];
+    if (c < 0x80)
+    {
+        *string += c != 0;
+        return c;
+    }
+
+    const utf8_lead_t *lead = &leads[c & 0x3F];
+    uint8_t c1 = s[1];
+    if (c < 0xC0 || lead->length == 0 || c1 < lead->low || c1 > lead->high)
+    {
+        *string += 1;
+        return UTF8_INVALID;
+    }
+
+    uint32_t length = lead->length;
+    uint32_t cp = ((c & (0x7F >> length)) << 6) | (c1 & 0x3F);
+    for (uint32_t i = 2; i < length; i++)
+    {
+        // NUL is no continuation byte, so this stops at the end of the string.
+        uint8_t cn = s[i];
+        if ((cn & 0xC0) != 0x80)
+        {
+            *string += i;
+            return UTF8_INVALID;
+        }
+        cp = (cp << 6) | (cn & 0x3F);
+    }
+    *string += length;
+    return cp;
+}
+
+
+__attribute__((no_sanitize_address))
+uint32_t utf8_ascii_span(const char *string, uint32_t max)
+{
+    const uint8_t *s = (const uint8_t *)string;
+    uint32_t n = 0;
+
+    // bytes 1 to 0x7F are ASCII, 0 and 0x80 to 0xFF wrap above 0x7E.
+    while (n < max && ((uintptr_t)(s + n) & 3) != 0)
+    {
+        if ((uint8_t)(s[n] - 1) >= 0x7F)
+        {
+            return n;
+        }
+        n++;
+    }
+
+    // an aligned word never crosses a page, reading past the NUL is harmless.
+    while (max - n >= 4)
+    {
+        uint32_t word;
+        memcpy(&word, __builtin_assume_aligned(s + n, 4), 4);
+        // high bit set by a non-ASCII byte, or by the borrow of a zero byte.
+        if (((word - 0x01010101) | word) & 0x80808080)
+        {
+            break;
+        }
+        n += 4;
+    }
+
+    while (n < max && (uint8_t)(s[n] - 1) < 0x7F)
+    {
+        n++;
+    }
+    return n;
+}
+
+
+uint32_t utf8_encode(uint32_t cp, char *out)
+{
+    if (cp < 0x80)
+    {
+        out[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800)
+    {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    if (cp < 0x10000)
+    {
+        if (cp >= 0xD800 && cp <= 0xDFFF)
+        {
+            return 0;
+        }
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    if (cp < 0x110000)
+    {
+        out[0] = 0xF0 | (cp >> 18);
+        out[1] = 0x80 | ((cp >> 12) & 0x3F);
+        out[2] = 0x80 | ((cp >> 6) & 0x3F);
+        out[3] = 0x80 | (cp & 0x3F);
+        return 4;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/***        END OF FILE                                                     ***/
+/******************************************************************************/